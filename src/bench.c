@@ -0,0 +1,693 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality font engine         */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  bench.c - the benchmark harness shared by ftbench, gbench, and          */
+/*            fttimer.                                                      */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef  _GNU_SOURCE
+#define  _GNU_SOURCE /* we want to use extensions to `time.h' if available */
+#endif
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+  /* SunOS 4.1.* does not define CLOCKS_PER_SEC, so include <sys/param.h> */
+  /* to get the HZ macro which is the equivalent.                         */
+#if defined( __sun__ ) && !defined( SVR4 ) && !defined( __SVR4 )
+#include <sys/param.h>
+#define CLOCKS_PER_SEC HZ
+#endif
+
+#if defined __unix__ || ( defined __APPLE__ && defined __MACH__ )
+#include <unistd.h>  /* for the `_POSIX_XXX' feature macros */
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+/* Specify the timer: QPC for accurate wall time, GPT for user-mode time. */
+/* Otherwise, QPCT cycles are measured accurately but with huge overhead. */
+#define QPC
+
+  static double  interval;  /* of the performance counter, in us */
+#endif
+
+
+  /*
+   * Clocks
+   */
+
+  void
+  bench_init( void )
+  {
+#ifdef _WIN32
+    LARGE_INTEGER  freq;
+
+
+    QueryPerformanceFrequency( &freq );
+    interval = 1e6 / freq.QuadPart;
+#endif
+  }
+
+
+  double
+  bench_cpu_time( void )
+  {
+    /* NOTE: When building with the Mingw64 toolchain, `_POSIX_TIMERS` is
+     * defined, but function `clock_gettime` is not.  Ensure that the
+     * `_WIN32` specific timer code appears first here.
+     */
+#if defined  _WIN32
+
+#ifdef QPC
+    LARGE_INTEGER  ticks;
+
+
+    QueryPerformanceCounter( &ticks );
+
+    return  interval * ticks.QuadPart;
+
+#elif defined GPT
+    FILETIME  start, end, kern, user;
+
+
+    GetProcessTimes( GetCurrentProcess(), &start, &end, &kern, &user );
+
+    return  0.1 * user.dwLowDateTime + 429496729.6 * user.dwHighDateTime;
+
+#else
+    ULONG64  cycles;
+
+
+    QueryProcessCycleTime( GetCurrentProcess(), &cycles );
+
+    return  1e-3 * cycles; /* at 1GHz */
+
+#endif
+
+#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0
+    struct timespec  tv;
+
+
+    /* In the multi-threaded mode, each thread must only see its own */
+    /* CPU time; for a single thread both clocks are equivalent.     */
+#if defined _POSIX_THREAD_CPUTIME && _POSIX_THREAD_CPUTIME >= 0
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &tv );
+#elif defined _POSIX_CPUTIME
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &tv );
+#else
+    clock_gettime( CLOCK_REALTIME, &tv );
+#endif /* _POSIX_CPUTIME */
+
+    return 1E6 * (double)tv.tv_sec + 1E-3 * (double)tv.tv_nsec;
+
+#else
+    /* clock() accuracy has improved since glibc 2.18 */
+    return 1E6 * (double)clock() / (double)CLOCKS_PER_SEC;
+#endif /* _POSIX_TIMERS */
+  }
+
+
+  double
+  bench_wall_time( void )
+  {
+#if defined _WIN32
+    LARGE_INTEGER  ticks;
+
+
+    QueryPerformanceCounter( &ticks );
+
+    return  interval * ticks.QuadPart;
+
+#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0
+    struct timespec  tv;
+
+
+#if defined _POSIX_MONOTONIC_CLOCK && _POSIX_MONOTONIC_CLOCK >= 0
+    clock_gettime( CLOCK_MONOTONIC, &tv );
+#else
+    clock_gettime( CLOCK_REALTIME, &tv );
+#endif
+
+    return 1E6 * (double)tv.tv_sec + 1E-3 * (double)tv.tv_nsec;
+
+#else
+    return 1E6 * (double)time( NULL );
+#endif
+  }
+
+
+#define CALIBRATE_COUNT  1001
+
+  double
+  bench_calibrate( double  (*get_time)( void ) )
+  {
+    double  deltas[CALIBRATE_COUNT];
+    int     i;
+
+
+    for ( i = 0; i < CALIBRATE_COUNT; i++ )
+    {
+      double  t0 = get_time();
+
+
+      deltas[i] = get_time() - t0;
+    }
+
+    return bench_median( deltas, CALIBRATE_COUNT );
+  }
+
+
+  /*
+   * Samples
+   */
+
+  void
+  bench_samples_reset( bsamples_t*  samples )
+  {
+    memset( samples, 0, sizeof ( *samples ) );
+    samples->batch = 1;
+  }
+
+
+  void
+  bench_samples_add( bsamples_t*  samples,
+                     double       time,
+                     int          done )
+  {
+    samples->time += time;
+    samples->done += done;
+
+    if ( ++samples->pending < samples->batch )
+      return;
+
+    if ( samples->done )
+    {
+      if ( samples->count == BENCH_MAX_SAMPLES )
+      {
+        int  i;
+
+
+        for ( i = 0; i < BENCH_MAX_SAMPLES / 2; i++ )
+          samples->value[i] = ( samples->value[2 * i] +
+                                samples->value[2 * i + 1] ) / 2;
+
+        samples->count  = BENCH_MAX_SAMPLES / 2;
+        samples->batch *= 2;
+      }
+
+      samples->value[samples->count++] = samples->time / samples->done;
+    }
+
+    samples->time    = 0;
+    samples->done    = 0;
+    samples->pending = 0;
+  }
+
+
+  /* merge adjacent pairs of samples, doubling the batch size */
+  static void
+  compact_samples( double*  value,
+                   int*     count,
+                   int*     batch )
+  {
+    int  i;
+
+
+    for ( i = 0; i < *count / 2; i++ )
+      value[i] = ( value[2 * i] + value[2 * i + 1] ) / 2;
+
+    *count /= 2;
+    *batch *= 2;
+  }
+
+
+  void
+  bench_samples_merge( bsamples_t*  samples,
+                       bsamples_t*  other )
+  {
+    double  value[BENCH_MAX_SAMPLES];
+    int     count = other->count;
+    int     batch = other->batch;
+    int     i;
+
+
+    if ( !count )
+      return;
+
+    memcpy( value, other->value, (size_t)count * sizeof ( double ) );
+
+    /* all samples must cover the same number of iterations */
+    while ( batch < samples->batch )
+      compact_samples( value, &count, &batch );
+    while ( samples->batch < batch )
+      compact_samples( samples->value, &samples->count, &samples->batch );
+
+    for ( i = 0; i < count; i++ )
+    {
+      if ( samples->count == BENCH_MAX_SAMPLES )
+      {
+        int  j;
+
+
+        compact_samples( samples->value,
+                         &samples->count,
+                         &samples->batch );
+
+        /* keep the remaining new samples at the same batch size */
+        for ( j = 0; i + 2 * j + 1 < count; j++ )
+          value[j] = ( value[i + 2 * j] + value[i + 2 * j + 1] ) / 2;
+        count = j;
+        i     = 0;
+
+        if ( !count )
+          break;
+      }
+
+      samples->value[samples->count++] = value[i];
+    }
+  }
+
+
+  /*
+   * Statistics
+   */
+
+  int
+  bench_compare_doubles( const void*  a,
+                         const void*  b )
+  {
+    double  x = *(const double*)a;
+    double  y = *(const double*)b;
+
+
+    return x < y ? -1 : x > y;
+  }
+
+
+  double
+  bench_median( const double*  values,
+                int            count )
+  {
+    double*  v;
+    double   m;
+
+
+    if ( !count )
+      return 0;
+
+    v = (double*)malloc( (size_t)count * sizeof ( double ) );
+    if ( !v )
+      return 0;
+
+    memcpy( v, values, (size_t)count * sizeof ( double ) );
+    qsort( v, (size_t)count, sizeof ( double ), bench_compare_doubles );
+
+    m = count & 1 ? v[count / 2]
+                  : ( v[count / 2 - 1] + v[count / 2] ) / 2;
+
+    free( v );
+
+    return m;
+  }
+
+
+  int
+  bench_reject_outliers( const double*  values,
+                         int            count,
+                         int*           kept )
+  {
+    double*  dev;
+    double   m, mad;
+    int      i, n = 0;
+
+
+    for ( i = 0; i < count; i++ )
+      kept[i] = 1;
+
+    if ( count < 3 )
+      return count;
+
+    dev = (double*)malloc( (size_t)count * sizeof ( double ) );
+    if ( !dev )
+      return count;
+
+    m = bench_median( values, count );
+    for ( i = 0; i < count; i++ )
+      dev[i] = fabs( values[i] - m );
+    mad = bench_median( dev, count );
+
+    for ( i = 0; i < count; i++ )
+    {
+      if ( mad > 0 && 0.6745 * dev[i] / mad > 3.5 )
+        kept[i] = 0;
+      else
+        n++;
+    }
+
+    free( dev );
+
+    return n;
+  }
+
+
+  double
+  bench_confidence_half_width( const double*  values,
+                               const int*     kept,
+                               int            count )
+  {
+    /* two-sided 97.5% quantiles for 1 to 30 degrees of freedom */
+    static const double  t975[30] =
+    {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    double  sum = 0, var = 0, mean, t;
+    int     i, n = 0;
+
+
+    for ( i = 0; i < count; i++ )
+      if ( kept[i] )
+      {
+        sum += values[i];
+        n++;
+      }
+
+    if ( n < 2 )
+      return -1;
+
+    mean = sum / n;
+    for ( i = 0; i < count; i++ )
+      if ( kept[i] )
+        var += ( values[i] - mean ) * ( values[i] - mean );
+    var /= n - 1;
+
+    /* the approximation is good to 0.1% for more degrees of freedom */
+    t = n - 1 <= 30 ? t975[n - 2] : 1.96 + 2.5 / ( n - 1 );
+
+    return t * sqrt( var / n );
+  }
+
+
+  double
+  bench_confidence_interval( const double*  values,
+                             const int*     kept,
+                             int            count )
+  {
+    double  sum = 0, h;
+    int     i, n = 0;
+
+
+    for ( i = 0; i < count; i++ )
+      if ( kept[i] )
+      {
+        sum += values[i];
+        n++;
+      }
+
+    if ( n < 2 || sum <= 0 )
+      return -1;
+
+    h = bench_confidence_half_width( values, kept, count );
+
+    return 100 * h * n / sum;
+  }
+
+
+  void
+  bench_stats( const bsamples_t*  samples,
+               bstats_t*          stats )
+  {
+    int  i;
+
+
+    stats->count  = samples->count;
+    stats->min    = 0;
+    stats->max    = 0;
+    stats->median = bench_median( samples->value, samples->count );
+
+    for ( i = 0; i < samples->count; i++ )
+    {
+      if ( !i || samples->value[i] < stats->min )
+        stats->min = samples->value[i];
+      if ( !i || samples->value[i] > stats->max )
+        stats->max = samples->value[i];
+    }
+  }
+
+
+  /*
+   * Test cases
+   */
+
+  void
+  bench_suite_init( bsuite_t*    suite,
+                    const char*  tool,
+                    double       max_time )
+  {
+    memset( suite, 0, sizeof ( *suite ) );
+
+    suite->tool       = tool;
+    suite->format     = BENCH_FORMAT_TEXT;
+    suite->max_time   = max_time;
+    suite->clock      = bench_cpu_time;
+    suite->clock_name = "cpu";
+  }
+
+
+  void
+  bench_add( bsuite_t*     suite,
+             const char*   title,
+             bench_func_t  func,
+             bench_hook_t  prepare,
+             bench_hook_t  finish,
+             void*         user_data )
+  {
+    bcase_t*  c;
+
+
+    if ( suite->num_cases == BENCH_MAX_CASES )
+    {
+      fprintf( stderr, "%s: too many test cases\n", suite->tool );
+      return;
+    }
+
+    c = &suite->cases[suite->num_cases++];
+
+    c->title     = title;
+    c->func      = func;
+    c->prepare   = prepare;
+    c->finish    = finish;
+    c->user_data = user_data;
+  }
+
+
+  /* the minimum duration of a timed batch of calls, in us */
+#define MIN_BATCH_TIME  100.0
+
+  static void
+  run_case( bsuite_t*  suite,
+            bcase_t*   c )
+  {
+    bstats_t  stats;
+    double    start;
+    int       calls = 0;
+    int       batch = 1;
+
+
+    if ( c->prepare )
+      c->prepare( c->user_data );
+
+    bench_samples_reset( &suite->samples );
+    stats.done = 0;
+    stats.time = 0;
+
+    start = suite->clock();
+    do
+    {
+      double  t;
+      int     done = 0;
+      int     i;
+
+
+      if ( suite->max_iter && batch > suite->max_iter - calls )
+        batch = suite->max_iter - calls;
+
+      /* time whole batches, so that short calls stay measurable */
+      t = suite->clock();
+      for ( i = 0; i < batch; i++ )
+      {
+        int  n = c->func( c->user_data );
+
+
+        if ( n > 0 )
+          done += n;
+      }
+      t = suite->clock() - t - suite->overhead;
+
+      bench_samples_add( &suite->samples, t, done );
+      stats.done += done;
+      stats.time += t;
+      calls      += batch;
+
+      if ( t < MIN_BATCH_TIME && batch < 0x10000 )
+        batch *= 2;
+
+    } while ( ( !suite->max_iter || calls < suite->max_iter )     &&
+              suite->clock() - start < 1E6 * suite->max_time );
+
+    if ( stats.done )
+    {
+      stats.us_per_op = stats.time / stats.done;
+      bench_stats( &suite->samples, &stats );
+
+      bench_report( suite, c->title, NULL, &stats );
+    }
+    else
+      bench_report( suite, c->title, "no error-free calls", NULL );
+
+    if ( c->finish )
+      c->finish( c->user_data );
+  }
+
+
+  void
+  bench_run( bsuite_t*    suite,
+             const char*  tests )
+  {
+    int  i;
+
+
+    suite->overhead = bench_calibrate( suite->clock );
+
+    bench_report_begin( suite );
+
+    for ( i = 0; i < suite->num_cases; i++ )
+      if ( !tests || strchr( tests, 'a' + i ) )
+        run_case( suite, &suite->cases[i] );
+
+    bench_report_end( suite );
+  }
+
+
+  /*
+   * Reporters
+   */
+
+  void
+  bench_print_string( const char*  s,
+                      int          csv )
+  {
+    putchar( '"' );
+
+    for ( ; s && *s; s++ )
+    {
+      unsigned char  c = (unsigned char)*s;
+
+
+      if ( csv )
+      {
+        if ( c == '"' )
+          putchar( '"' );
+        putchar( c );
+      }
+      else if ( c == '"' || c == '\\' )
+        printf( "\\%c", c );
+      else if ( c < 0x20 )
+        printf( "\\u%04x", c );
+      else
+        putchar( c );
+    }
+
+    putchar( '"' );
+  }
+
+
+  void
+  bench_report_begin( bsuite_t*  suite )
+  {
+    suite->num_results = 0;
+
+    if ( suite->format != BENCH_FORMAT_JSON )
+      return;
+
+    printf( "{\n"
+            "  \"tool\": " );
+    bench_print_string( suite->tool, 0 );
+    printf( ",\n"
+            "  \"options\": {\n"
+            "    \"max_iter\": %d,\n"
+            "    \"max_time\": %g,\n"
+            "    \"clock\": ",
+            suite->max_iter,
+            suite->max_time );
+    bench_print_string( suite->clock_name, 0 );
+    printf( ",\n"
+            "    \"timer_overhead\": %.6g\n"
+            "  },\n"
+            "  \"results\": [\n",
+            suite->overhead );
+  }
+
+
+  void
+  bench_report( bsuite_t*        suite,
+                const char*      title,
+                const char*      status,
+                const bstats_t*  stats )
+  {
+    if ( suite->format == BENCH_FORMAT_JSON )
+    {
+      printf( "%s    { \"test\": ", suite->num_results ? ",\n" : "" );
+      bench_print_string( title, 0 );
+      printf( ", \"status\": " );
+      bench_print_string( status ? status : "ok", 0 );
+      if ( !status )
+      {
+        printf( ", \"done\": %d, \"us_per_op\": %.6g",
+                stats->done, stats->us_per_op );
+        if ( stats->count )
+          printf( ", \"samples\": %d, \"min\": %.6g, \"p50\": %.6g,"
+                  " \"max\": %.6g",
+                  stats->count, stats->min, stats->median, stats->max );
+      }
+      printf( " }" );
+    }
+    else if ( status )
+      printf( "  %-25s %s\n", title, status );
+    else
+      printf( "  %-25s %10.3f us/op %10d done\n",
+              title, stats->us_per_op, stats->done );
+
+    suite->num_results++;
+    fflush( stdout );
+  }
+
+
+  void
+  bench_report_end( bsuite_t*  suite )
+  {
+    if ( suite->format == BENCH_FORMAT_JSON )
+      printf( "%s  ]\n"
+              "}\n",
+              suite->num_results ? "\n" : "" );
+  }
+
+
+/* End */
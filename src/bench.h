@@ -0,0 +1,261 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality font engine         */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  bench.h - the benchmark harness shared by ftbench, gbench, and          */
+/*            fttimer: clocks, a fixed-size sample store, summary           */
+/*            statistics, test case registration, and text and JSON         */
+/*            reporters.  ftbench only uses the clocks, the sample store,   */
+/*            and the statistics; it times sections within its tests and    */
+/*            has its own runner and reporters.                             */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+
+  /*
+   * Clocks, in microseconds.  `bench_cpu_time' returns the CPU time of
+   * the calling thread if available (otherwise of the whole process),
+   * `bench_wall_time' a monotonic wall clock.  Call `bench_init' once
+   * before using them.
+   */
+
+  extern void
+  bench_init( void );
+
+  extern double
+  bench_cpu_time( void );
+
+  extern double
+  bench_wall_time( void );
+
+  /*
+   * Return the median cost of an empty timed section with `get_time',
+   * to be subtracted from all timed sections.
+   */
+  extern double
+  bench_calibrate( double  (*get_time)( void ) );
+
+
+  /*
+   * Fixed-size store of per-iteration samples (average time per
+   * operation).  If the store is full, adjacent samples get merged and
+   * the number of iterations per sample doubles, so that the samples
+   * always cover the whole run of a test.
+   */
+
+#define BENCH_MAX_SAMPLES  512
+
+  typedef struct  bsamples_t_ {
+    double  value[BENCH_MAX_SAMPLES];
+    int     count;
+    int     batch;    /* iterations per sample */
+    int     pending;  /* iterations accumulated so far */
+    double  time;
+    int     done;
+
+  } bsamples_t;
+
+
+  extern void
+  bench_samples_reset( bsamples_t*  samples );
+
+  /* add an iteration of `done' operations that took `time' */
+  extern void
+  bench_samples_add( bsamples_t*  samples,
+                     double       time,
+                     int          done );
+
+  /*
+   * Append the samples of `other'.  The store with the smaller batch
+   * size gets compacted first, so that all samples cover the same number
+   * of iterations; if the store is full, it gets compacted again.
+   */
+  extern void
+  bench_samples_merge( bsamples_t*  samples,
+                       bsamples_t*  other );
+
+
+  /*
+   * Summary statistics
+   */
+
+  /* `qsort' comparison function for doubles in ascending order */
+  extern int
+  bench_compare_doubles( const void*  a,
+                         const void*  b );
+
+  extern double
+  bench_median( const double*  values,
+                int            count );
+
+  /*
+   * Reject outliers among `count' values with the modified z-score
+   * (Iglewicz and Hoaglin): a value is an outlier if its distance to the
+   * median exceeds 3.5 times the median absolute deviation, scaled to
+   * the standard deviation of a normal distribution.  Set `kept[i]'
+   * accordingly and return the number of kept values.
+   */
+  extern int
+  bench_reject_outliers( const double*  values,
+                         int            count,
+                         int*           kept );
+
+  /*
+   * Return the half width of the 95% confidence interval of the mean of
+   * the kept values (using Student's t distribution), relative to the
+   * mean and in percent, or a negative value if there are too few values.
+   */
+  extern double
+  bench_confidence_interval( const double*  values,
+                             const int*     kept,
+                             int            count );
+
+  /*
+   * Like `bench_confidence_interval', but return the half width in the
+   * unit of the values, which may be negative (for example, logarithms).
+   */
+  extern double
+  bench_confidence_half_width( const double*  values,
+                               const int*     kept,
+                               int            count );
+
+
+  typedef struct  bstats_t_ {
+    int     done;       /* successful operations */
+    double  time;       /* sum of all timed sections, in us */
+    double  us_per_op;
+    int     count;      /* number of samples */
+    double  min;        /* of the samples, in us per operation */
+    double  median;
+    double  max;
+
+  } bstats_t;
+
+
+  /* set the sample fields of `stats' */
+  extern void
+  bench_stats( const bsamples_t*  samples,
+               bstats_t*          stats );
+
+
+  /*
+   * Test cases.  A test function performs some operations and returns
+   * the number of them that succeeded; it gets called repeatedly, in
+   * timed batches, until either `max_iter' calls or `max_time' seconds
+   * are reached.  The optional `prepare' function is called (untimed)
+   * before the first call of a test case, `finish' after its result
+   * has been reported.
+   */
+
+  typedef int
+  (*bench_func_t)( void*  user_data );
+
+  typedef void
+  (*bench_hook_t)( void*  user_data );
+
+
+  typedef struct  bcase_t_ {
+    const char*   title;
+    bench_func_t  func;
+    bench_hook_t  prepare;
+    bench_hook_t  finish;
+    void*         user_data;
+
+  } bcase_t;
+
+
+  enum
+  {
+    BENCH_FORMAT_TEXT,
+    BENCH_FORMAT_JSON
+  };
+
+#define BENCH_MAX_CASES  26  /* test letters `a' to `z' */
+
+
+  typedef struct  bsuite_t_ {
+    const char*  tool;
+    int          format;      /* BENCH_FORMAT_XXX */
+    int          max_iter;    /* zero for no limit */
+    double       max_time;    /* in seconds */
+    double       (*clock)( void );
+    const char*  clock_name;
+    double       overhead;    /* of an empty timed section */
+    int          num_cases;
+    bcase_t      cases[BENCH_MAX_CASES];
+    int          num_results;
+    bsamples_t   samples;
+
+  } bsuite_t;
+
+
+  /* initialize `suite' with the CPU clock and no test cases */
+  extern void
+  bench_suite_init( bsuite_t*    suite,
+                    const char*  tool,
+                    double       max_time );
+
+  /* register a test case; the first one gets test letter `a' */
+  extern void
+  bench_add( bsuite_t*     suite,
+             const char*   title,
+             bench_func_t  func,
+             bench_hook_t  prepare,
+             bench_hook_t  finish,
+             void*         user_data );
+
+  /*
+   * Run and report all test cases whose letters are in `tests' (all if
+   * NULL), between `bench_report_begin' and `bench_report_end'.
+   */
+  extern void
+  bench_run( bsuite_t*    suite,
+             const char*  tests );
+
+
+  /*
+   * Reporters.  In JSON format, the output is an object with the tool,
+   * its options, and an array of results with the same keys as the
+   * results of `ftbench -F json'.
+   */
+
+  extern void
+  bench_report_begin( bsuite_t*  suite );
+
+  /* `status' is NULL if the test ran */
+  extern void
+  bench_report( bsuite_t*        suite,
+                const char*      title,
+                const char*      status,
+                const bstats_t*  stats );
+
+  extern void
+  bench_report_end( bsuite_t*  suite );
+
+  /* print a quoted string, escaped for JSON or (if `csv' is set) CSV */
+  extern void
+  bench_print_string( const char*  s,
+                      int          csv );
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* BENCH_H_ */
+
+
+/* End */
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 #include <ft2build.h>
 
 #include FT_FREETYPE_H
@@ -34,33 +35,166 @@
 #include FT_MODULE_H
 #include FT_DRIVER_H
 #include FT_LCD_FILTER_H
+#include FT_MULTIPLE_MASTERS_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+#include FT_COLOR_H
+#include FT_BITMAP_H
+#include FT_FONT_FORMATS_H
+#include FT_SIZES_H
 
 #ifdef UNIX
 #include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #else
 #include "mlgetopt.h"
 #endif
 
-#include "common.h"
+  /* the multi-threaded mode needs POSIX threads */
+#if defined _POSIX_THREADS && _POSIX_THREADS > 0
+#define FTBENCH_THREADS
+#include <pthread.h>
+#endif
 
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+  /* memory-mapped preloading */
+#if defined _POSIX_MAPPED_FILES && _POSIX_MAPPED_FILES > 0
+#define FTBENCH_MMAP
+#include <sys/mman.h>
+#endif
 
-/* Specify the timer: QPC for accurate wall time, GPT for user-mode time. */
-/* Otherwise, QPCT cycles are measured accurately but with huge overhead. */
-#define QPC
+  /* dropping files from the page cache (option `-d') */
+#if defined UNIX && defined POSIX_FADV_DONTNEED
+#define FTBENCH_COLD_CACHE
+#endif
 
-#ifdef QPC
-  double  interval;
+  /* hardware performance counters are only supported on Linux */
+#ifdef __linux__
+#define FTBENCH_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>   /* for `syscall', `read', and `close' */
 #endif
 
+  /* pinning threads to CPUs (option `-A') */
+#ifdef __linux__
+#include <sched.h>
+#ifdef CPU_SET
+#define FTBENCH_AFFINITY
+#endif
 #endif
 
+  /* injecting I/O latency (option `-D') needs `nanosleep' */
+#if defined _POSIX_TIMERS && _POSIX_TIMERS > 0
+#define FTBENCH_IO_LATENCY
+#endif
 
-  typedef struct  btimer_t_ {
-    double  t0;
+  /* the A/B mode (option `-y') loads two FreeType builds dynamically */
+#ifdef UNIX
+#include <dlfcn.h>
+#ifdef RTLD_LOCAL
+#define FTBENCH_AB
+#include <stddef.h>  /* for `offsetof' */
+#endif
+#endif
+
+#include "common.h"
+#include "bench.h"
+
+  /*
+   * Latency histogram with logarithmic buckets (similar to HdrHistogram):
+   * durations are stored in nanoseconds, with `HISTO_SUB_COUNT' linear
+   * sub-buckets per power of two, giving a relative precision of about
+   * 1.5%.
+   */
+
+#define HISTO_SUB_BITS   6
+#define HISTO_SUB_COUNT  ( 1 << HISTO_SUB_BITS )
+#define HISTO_MAX_SHIFT  36                      /* about 73 minutes */
+#define HISTO_SIZE       ( ( HISTO_MAX_SHIFT + 2 ) * HISTO_SUB_COUNT )
+
+  typedef struct  bhisto_t_ {
+    double  count[HISTO_SIZE];
     double  total;
+    double  min;
+    double  max;
+
+  } bhisto_t;
+
+
+  /*
+   * Hardware performance counters, active during timed sections only.
+   */
+
+  enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_MAX
+  };
+
+  static const char*  perf_names[PERF_MAX] =
+  {
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses"
+  };
+
+
+  typedef struct  bperf_t_ {
+    int     fd[PERF_MAX];     /* -1 if not available */
+    int     leader;           /* file descriptor of group leader */
+    double  count[PERF_MAX];  /* negative if not available */
+
+  } bperf_t;
+
+
+  /*
+   * Allocation counts of the timed sections, and the peak number of
+   * bytes allocated while running a test.
+   */
+
+  typedef struct  bmem_t_ {
+    double  allocs;  /* including reallocations */
+    double  frees;
+    double  bytes;   /* bytes requested */
+    double  peak;
+
+  } bmem_t;
+
+
+  /*
+   * Reads of the instrumented streams (option `-O').
+   */
+
+  typedef struct  bio_t_ {
+    double  faces;     /* faces opened */
+    double  reads;
+    double  seeks;     /* calls of the read function with a zero count */
+    double  bytes;
+    double  distinct;  /* bytes not read before from the same face */
+
+  } bio_t;
+
+
+  typedef struct  btimer_t_ {
+    double     t0;
+    double     total;
+    bhisto_t*  histo;    /* if non-NULL, record each timed section */
+    bperf_t*   perf;     /* if non-NULL, count events in timed sections */
+    bmem_t*    mem;      /* if non-NULL, count allocations, too */
+    double     lookups;  /* glyph cache lookups done by the test */
+    double     misses;   /* ... and how many of them had to load a glyph */
+    double     locks;    /* acquisitions of the shared cache's mutex */
+    double     lock_wait;  /* wall-clock time, in us */
+    double     lock_hold;
+    double     lock_t0;
 
   } btimer_t;
 
@@ -76,6 +210,7 @@
     bcall_t      bench;
     int          cache_first;
     void*        user_data;
+    const char*  lookup_unit;  /* what the lookups find; NULL for glyphs */
 
   } btest_t;
 
@@ -88,9 +223,100 @@
   } bcharset_t;
 
 
+  /* what to time in the variation tests */
+  enum {
+    VAR_TIME_SWITCH,
+    VAR_TIME_LOAD,
+    VAR_TIME_ADVANCES
+  };
+
+  typedef struct  bvar_t_
+  {
+    FT_UInt    num_axes;
+    int        num_instances;
+    FT_Fixed*  coords;  /* `num_instances' times `num_axes' values */
+    FT_Fixed*  saved;   /* the face's coordinates before the tests */
+    int        timed;   /* VAR_TIME_XXX */
+
+  } bvar_t;
+
+
+  /* per-font results of the corpus mode (several font files); */
+  /* the array grows in steps of `FONT_RESULTS_STEP' entries     */
+#define FONT_RESULTS_STEP  32
+
+  typedef struct  bfontresult_t_
+  {
+    char*   title;     /* a copy, since titles can be built on the fly */
+    int     done;
+    double  time;
+    double  bytes;     /* allocated during the timed sections (option `-a') */
+    double  relative;  /* us/op relative to the corpus median, or 0 */
+
+  } bfontresult_t;
+
+
+  typedef struct  bfont_t_
+  {
+    char*           filename;
+    FT_Long         face_index;   /* including the named instance */
+    char*           family;
+    char*           style;
+    const char*     status;       /* why the font wasn't benchmarked */
+    double          cost;         /* sum of us/op of all tests */
+    double          score;        /* geometric mean of the relative us/op */
+    int             num_results;
+    int             max_results;
+    int             dropped;      /* results lost for lack of memory */
+    bfontresult_t*  results;
+
+  } bfont_t;
+
+
   static FT_Error
   get_face( FT_Face*  face );
 
+  static FT_Error
+  set_face_size( FT_Face  face );
+
+  static void
+  set_library_properties( FT_Library  library );
+
+  static FT_Error
+  get_new_face( FT_Face*   face,
+                FT_Byte**  adata,
+                size_t*    asize );
+
+  static void
+  unload_font_data( int       mode,
+                    FT_Byte*  data,
+                    size_t    size );
+
+  static void
+  drop_page_cache( void );
+
+  static void
+  benchmark_font( FT_Face   face,
+                  btest_t*  test,
+                  int       max_iter,
+                  double    max_time );
+
+  static void
+  free_font_results( bfont_t*  font );
+
+#ifdef FTBENCH_THREADS
+  static void
+  benchmark_threads( btest_t*  test,
+                     int       max_iter,
+                     double    max_time );
+
+  static void
+  benchmark_shared( FT_Face   face,
+                    btest_t*  test,
+                    int       max_iter,
+                    double    max_time );
+#endif
+
 
   /*
    * Globals
@@ -100,13 +326,33 @@
 #define BENCH_TIME  2.0
 #define FACE_SIZE   10
 
+  /* Every thread of the multi-threaded mode (option `-j') uses its own */
+  /* library, face, and cache manager; we thus keep the corresponding  */
+  /* objects in thread-local storage.                                  */
+#ifndef FTBENCH_THREADS
+#define THREAD_LOCAL  /* empty */
+#elif defined __GNUC__
+#define THREAD_LOCAL  __thread
+#else
+#define THREAD_LOCAL  _Thread_local
+#endif
+
+  static THREAD_LOCAL FT_Library      lib;
+  static THREAD_LOCAL FTC_Manager     cache_man;
+  static THREAD_LOCAL FTC_CMapCache   cmap_cache;
+  static THREAD_LOCAL FTC_ImageCache  image_cache;
+  static THREAD_LOCAL FTC_SBitCache   sbit_cache;
 
-  static FT_Library        lib;
-  static FTC_Manager       cache_man;
-  static FTC_CMapCache     cmap_cache;
-  static FTC_ImageCache    image_cache;
-  static FTC_SBitCache     sbit_cache;
-  static FTC_ImageTypeRec  font_type;
+  static THREAD_LOCAL FTC_ImageTypeRec  font_type;
+
+  /* In corpus mode, worker threads benchmark different fonts; */
+  /* the current font is thus thread-local, too.               */
+  static THREAD_LOCAL char*     filename;
+  static THREAD_LOCAL FT_Long   face_index;
+  static THREAD_LOCAL FT_Byte*  font_data;     /* if preloaded */
+  static THREAD_LOCAL size_t    font_data_size;
+  static THREAD_LOCAL int       font_data_mode;
+  static THREAD_LOCAL bfont_t*  current_font;  /* non-NULL in corpus mode */
 
 
   enum {
@@ -122,6 +368,15 @@
     FT_BENCH_GET_BBOX,
     FT_BENCH_GET_CBOX,
     FT_BENCH_NEW_FACE_AND_LOAD_GLYPH,
+    FT_BENCH_TEXT,
+    FT_BENCH_VARIATION,
+    FT_BENCH_COLOR,
+    N_FT_BENCH_DEFAULT,  /* the tests from here on need option `-b' */
+    FT_BENCH_SDF = N_FT_BENCH_DEFAULT,
+    FT_BENCH_OUTLINE,
+    FT_BENCH_LAYOUT,
+    FT_BENCH_FIRST_GLYPH,
+    FT_BENCH_SIZES,
     N_FT_BENCH
   };
 
@@ -141,16 +396,98 @@
     "get glyph cbox      (FT_Glyph_Get_CBox)",
 
     "open face and load glyphs",
+    "replay text corpus  (FTC_*_Lookup, option `-u')",
+    "switch instances    (FT_Set_Var_Design_Coordinates)",
+    "load color glyphs   (FT_LOAD_COLOR, FT_Get_Color_Glyph_Layer)",
+    "render SDF          (FT_RENDER_MODE_SDF, options `-S' and `-z')",
+    "process outlines    (FT_Outline_*)",
+    "lay out text        (FT_Get_Advances, FT_Get_Kerning, option `-u')",
+    "first glyph latency (FT_Init_FreeType to FT_Render_Glyph)",
+    "switch sizes        (FT_New_Size, FTC_Manager_LookupSize)",
     NULL
   };
 
 
-  static int    preload;
-  static char*  filename;
-
-  static unsigned int  first_index = 0U;
-  static unsigned int  last_index  = ~0U;
-  static int           incr_index  = 1;
+  /* how to preload the font file (options `-p' and `-P') */
+#define PRELOAD_READ      1  /* `malloc' and `fread' */
+#define PRELOAD_MMAP      2
+#define PRELOAD_POPULATE  4  /* prefault the mapping */
+#define PRELOAD_HUGE      8  /* ask for transparent huge pages */
+
+  static int            preload;
+  static char           preload_mode[32] = "none";
+  static int            cold_cache;
+  static char*          text_file;
+  static char*          var_file;
+  static char*          test_string;
+  static int            compare_cached;
+  static bcharset_t     text;
+  static unsigned int   face_size   = FACE_SIZE;
+  static unsigned int   requested_size;  /* even for bitmap fonts */
+  static unsigned long  max_bytes   = CACHE_SIZE * 1024;
+  static FT_UInt        max_sizes;  /* of the cache managers, 0 = default */
+  static int            num_threads = 1;
+  static int            share_caches;  /* option `-G' */
+
+  /* the maximum number of values of a list option */
+#define MAX_LIST_VALUES  32
+
+  /* the cache sizes of the sweep mode (option `-M'), in KiByte */
+  static unsigned long  sweep_sizes[MAX_LIST_VALUES];
+  static int            num_sweep_sizes;
+
+  /* the face sizes (option `-z') and spreads (option `-S') of test `p' */
+  static double  sdf_sizes[MAX_LIST_VALUES];
+  static int     num_sdf_sizes;
+  static int     sdf_spreads[MAX_LIST_VALUES] = { 8 };
+  static int     num_sdf_spreads = 1;
+
+  /* the face sizes of the size sweep (option `-Z'), in ppem */
+  static double  ppem_sizes[MAX_LIST_VALUES];
+  static int     num_ppem_sizes;
+
+  /* if non-zero, the fractional face size overriding `face_size' */
+  static FT_F26Dot6  char_size;
+
+  /* noise control (options `-W', `-A', `-k', `-E', and `-L') */
+#define MAX_REPEATS  64
+#define REPEAT_TIME  60.0
+
+  static int     warmup_iter;
+  static int     pin_cpu         = -1;
+  static int     num_repeats     = 1;
+  static double  target_ci;                   /* in percent, or zero */
+  static double  max_repeat_time = REPEAT_TIME;
+
+  /* the dimensions of the hinting matrix (option `-X'), e.g. "ihtal" */
+  static const char*  matrix_dims;
+
+  /* instrumented streams (options `-O', `-o', and `-D') */
+  static int          use_streams;
+  static double       io_latency;  /* per read, in microseconds */
+  static char*        io_trace_file;
+  static FILE*        io_trace;
+  static bio_t*       io_counts;   /* NULL if not counting */
+  static const char*  io_phase;    /* the current test, for the trace */
+
+  /* soak mode (options `-Q' and `-q'), in seconds */
+#define SOAK_INTERVAL  60.0
+
+  static double  soak_time;
+  static double  soak_interval = SOAK_INTERVAL;
+
+  /* the two libraries of the A/B mode (option `-y') */
+  static char*  ab_libs[2];
+  static char   ab_versions[2][32];
+
+  /* the glyph index range of option `-i', ... */
+  static unsigned int  range_first = 0U;
+  static unsigned int  range_last  = ~0U;
+
+  /* ... clamped to the number of glyphs of the current face */
+  static THREAD_LOCAL unsigned int  first_index;
+  static THREAD_LOCAL unsigned int  last_index;
+  static THREAD_LOCAL int           incr_index;
 
 #define FOREACH( i )  for ( i = first_index ;                          \
                             ( first_index <= i && i <= last_index ) || \
@@ -171,6 +508,13 @@
   static char  ps_hinting_engine_names[2][10] = { "freetype",
                                                   "adobe" };
 
+  /* properties to be applied to every new library object */
+  static int           tt_interpreter_version = -1;
+  static int           ps_hinting_engine      = -1;
+  static FT_LcdFilter  lcd_filter             = FT_LCD_FILTER_NONE;
+  static int           lcd_filter_set;
+  static int           sdf_spread             = -1;
+
 
   /*
    * Dummy face requester (the face object is already loaded)
@@ -191,833 +535,9468 @@
   }
 
 
-  /*
-   * timer in milliseconds
-   */
+#if !defined _WIN32                                   && \
+    defined _POSIX_TIMERS && _POSIX_TIMERS > 0        && \
+    defined _POSIX_CPUTIME && _POSIX_CPUTIME >= 0
+
+#define FTBENCH_PROCESS_CLOCK
 
+  /* CPU time of all threads, in microseconds */
   static double
-  get_time( void )
+  get_process_time( void )
   {
-    /* NOTE: When building with the Mingw64 toolchain, `_POSIX_TIMERS` is
-     * defined, but function `clock_gettime` is not.  Ensure that the
-     * `_WIN32` specific timer code appears first here.
-     */
-#if defined  _WIN32
-
-#ifdef QPC
-    LARGE_INTEGER  ticks;
+    struct timespec  tv;
 
 
-    QueryPerformanceCounter( &ticks );
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &tv );
 
-    return  interval * ticks.QuadPart;
+    return 1E6 * (double)tv.tv_sec + 1E-3 * (double)tv.tv_nsec;
+  }
 
-#elif defined GPT
-    FILETIME  start, end, kern, user;
+#endif /* FTBENCH_PROCESS_CLOCK */
 
 
-    GetProcessTimes( GetCurrentProcess(), &start, &end, &kern, &user );
+#if defined __GNUC__ && ( defined __i386__ || defined __x86_64__ )
 
-    return  0.1 * user.dwLowDateTime + 429496729.6 * user.dwHighDateTime;
+#define FTBENCH_TSC
 
-#else
-    ULONG64  cycles;
+  static unsigned long long  tsc_base;
+  static double              tsc_per_us;
 
 
-    QueryProcessCycleTime( GetCurrentProcess(), &cycles );
+  /*
+   * Time stamp counter in microseconds.  Modern x86 CPUs increment it at
+   * a constant rate (independent of frequency scaling), which is
+   * calibrated against the wall clock.  Reading it is much cheaper than
+   * a system call, but it also counts while the thread isn't running.
+   */
 
-    return  1e-3 * cycles; /* at 1GHz */
+  static double
+  get_tsc_time( void )
+  {
+    return (double)( __builtin_ia32_rdtsc() - tsc_base ) / tsc_per_us;
+  }
 
-#endif
 
-#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0
-    struct timespec  tv;
+  static void
+  calibrate_tsc( void )
+  {
+    double  t0, t1;
 
 
-#ifdef _POSIX_CPUTIME
-    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &tv );
-#else
-    clock_gettime( CLOCK_REALTIME, &tv );
-#endif /* _POSIX_CPUTIME */
+    tsc_base = __builtin_ia32_rdtsc();
+    t0       = bench_wall_time();
 
-    return 1E6 * (double)tv.tv_sec + 1E-3 * (double)tv.tv_nsec;
+    do
+      t1 = bench_wall_time();
+    while ( t1 - t0 < 20000 );
 
-#else
-    /* clock() accuracy has improved since glibc 2.18 */
-    return 1E6 * (double)clock() / (double)CLOCKS_PER_SEC;
-#endif /* _POSIX_TIMERS */
+    tsc_per_us = (double)( __builtin_ia32_rdtsc() - tsc_base ) / ( t1 - t0 );
   }
 
-#define TIMER_START( timer )  ( timer )->t0 = get_time()
-#define TIMER_STOP( timer )   ( timer )->total += get_time() - ( timer )->t0
-#define TIMER_GET( timer )    ( timer )->total
-#define TIMER_RESET( timer )  ( timer )->total = 0
+#endif /* FTBENCH_TSC */
+
+
+  /* the clocks selectable with option `-K' */
+  typedef struct  bclock_t_ {
+    const char*  name;
+    double       (*get)( void );
+
+  } bclock_t;
+
+  static const bclock_t  clocks[] =
+  {
+    { "cpu",     bench_cpu_time },   /* thread CPU time if available */
+#ifdef FTBENCH_PROCESS_CLOCK
+    { "process", get_process_time },
+#endif
+    { "wall",    bench_wall_time },
+#ifdef FTBENCH_TSC
+    { "tsc",     get_tsc_time },
+#endif
+    { NULL,      NULL }
+  };
+
+
+  /* the clock of all timed sections */
+  static double       (*timer_clock)( void ) = bench_cpu_time;
+  static const char*  clock_name             = "cpu";
+
+  /* the median cost of an empty timed section, subtracted from all */
+  static double  timer_overhead;
 
 
   /*
-   * Bench code
+   * Latency histograms
    */
 
   static void
-  benchmark( FT_Face   face,
-             btest_t*  test,
-             int       max_iter,
-             double    max_time )
+  histo_reset( bhisto_t*  histo )
   {
-    int       n, done;
-    btimer_t  timer, elapsed;
+    memset( histo, 0, sizeof ( *histo ) );
+  }
 
 
-    if ( test->cache_first )
-    {
-      if ( !cache_man )
-      {
-        printf( "  %-25s no cache manager\n", test->title );
+  static void
+  histo_add( bhisto_t*  histo,
+             double     value,   /* in microseconds */
+             double     weight )
+  {
+    double  ns    = value * 1000.0;
+    double  limit = 2 * HISTO_SUB_COUNT;
+    int     shift = 0;
 
-        return;
-      }
 
-      TIMER_RESET( &timer );
-      test->bench( &timer, face, test->user_data );
+    if ( value < 0 )
+    {
+      value = 0;
+      ns    = 0;
     }
 
-    printf( "  %-25s ", test->title );
-    fflush( stdout );
+    while ( ns >= limit && shift < HISTO_MAX_SHIFT )
+    {
+      ns /= 2;
+      shift++;
+    }
+    if ( ns >= limit )
+      ns = limit - 1;
 
-    TIMER_RESET( &timer );
-    TIMER_RESET( &elapsed );
+    histo->count[shift * HISTO_SUB_COUNT + (int)ns] += weight;
 
-    for ( n = 0, done = 0; !max_iter || n < max_iter; n++ )
+    if ( !histo->total || value < histo->min )
+      histo->min = value;
+    if ( !histo->total || value > histo->max )
+      histo->max = value;
+    histo->total += weight;
+  }
+
+
+#ifdef FTBENCH_THREADS
+
+  static void
+  histo_merge( bhisto_t*  histo,
+               bhisto_t*  other )
+  {
+    int  i;
+
+
+    if ( !other->total )
+      return;
+
+    for ( i = 0; i < HISTO_SIZE; i++ )
+      histo->count[i] += other->count[i];
+
+    if ( !histo->total || other->min < histo->min )
+      histo->min = other->min;
+    if ( !histo->total || other->max > histo->max )
+      histo->max = other->max;
+    histo->total += other->total;
+  }
+
+#endif /* FTBENCH_THREADS */
+
+
+  /* return the value at quantile `q' (0 <= q <= 1), in microseconds */
+  static double
+  histo_quantile( bhisto_t*  histo,
+                  double     q )
+  {
+    double  sum = 0, rank = q * histo->total;
+    int     i;
+
+
+    for ( i = 0; i < HISTO_SIZE; i++ )
     {
-      TIMER_START( &elapsed );
+      sum += histo->count[i];
+      if ( histo->count[i] && sum >= rank )
+      {
+        int     shift = i < 2 * HISTO_SUB_COUNT ? 0
+                                                : i / HISTO_SUB_COUNT - 1;
+        double  width = (double)( 1ULL << shift );
+        double  value = ( ( i - shift * HISTO_SUB_COUNT ) * width +
+                          width / 2 ) / 1000.0;
 
-      done += test->bench( &timer, face, test->user_data );
 
-      TIMER_STOP( &elapsed );
+        /* the bucket's midpoint might lie outside of the real range */
+        if ( value < histo->min )
+          value = histo->min;
+        if ( value > histo->max )
+          value = histo->max;
 
-      if ( TIMER_GET( &elapsed ) > 1E6 * max_time )
-        break;
+        return value;
+      }
     }
 
-    if ( done )
-      printf( "%10.3f us/op %10d done\n",
-              TIMER_GET( &timer ) / (double)done, done );
-    else
-      printf( "no error-free calls\n" );
+    return histo->max;
   }
 
 
   /*
-   * Various tests
+   * Performance counters
    */
 
-  static int
-  test_load( btimer_t*  timer,
-             FT_Face    face,
-             void*      user_data )
-  {
-    unsigned int  i;
-    int           done = 0;
+  static int      use_perf_events;
+  static bperf_t  main_perf;
 
-    FT_UNUSED( user_data );
 
+#ifdef FTBENCH_PERF_EVENTS
 
-    TIMER_START( timer );
+  static void
+  perf_close( bperf_t*  perf )
+  {
+    int  i;
 
-    FOREACH( i )
+
+    for ( i = 0; i < PERF_MAX; i++ )
     {
-      if ( !FT_Load_Glyph( face, i, load_flags ) )
-        done++;
+      if ( perf->fd[i] >= 0 )
+        close( perf->fd[i] );
+      perf->fd[i] = -1;
     }
-
-    TIMER_STOP( timer );
-
-    return done;
+    perf->leader = -1;
   }
 
 
+  /* open counters for the calling thread; return 0 if none is available */
   static int
-  test_load_advances( btimer_t*  timer,
-                      FT_Face    face,
-                      void*      user_data )
+  perf_open( bperf_t*  perf )
   {
-    int        done = 0;
-    FT_Fixed*  advances;
-    FT_ULong   flags = *((FT_ULong*)user_data);
-    FT_UInt    start, count;
-
+    static const struct
+    {
+      unsigned int        type;
+      unsigned long long  config;
 
-    if ( incr_index > 0 )
+    } events[PERF_MAX] =
     {
-      start = first_index;
-      count = last_index - first_index + 1;
-    }
-    else
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D                |
+                            PERF_COUNT_HW_CACHE_OP_READ << 8       |
+                            PERF_COUNT_HW_CACHE_RESULT_MISS << 16  },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+    };
+
+    int  i;
+
+
+    perf->leader = -1;
+
+    /* all counters form a single group so that they are */
+    /* enabled and disabled at once                       */
+    for ( i = 0; i < PERF_MAX; i++ )
     {
-      start = last_index;
-      count = first_index - last_index + 1;
+      struct perf_event_attr  attr;
+
+
+      memset( &attr, 0, sizeof ( attr ) );
+      attr.size           = sizeof ( attr );
+      attr.type           = events[i].type;
+      attr.config         = events[i].config;
+      attr.disabled       = perf->leader < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      perf->fd[i] = (int)syscall( __NR_perf_event_open,
+                                  &attr, 0, -1, perf->leader, 0 );
+      if ( perf->fd[i] >= 0 && perf->leader < 0 )
+        perf->leader = perf->fd[i];
     }
 
-    advances = (FT_Fixed *)calloc( sizeof ( FT_Fixed ), (size_t)count );
-
-    TIMER_START( timer );
+    return perf->leader >= 0;
+  }
 
-    FT_Get_Advances( face, start, count, (FT_Int32)flags, advances );
-    done += (int)count;
 
-    TIMER_STOP( timer );
+  static void
+  perf_reset( bperf_t*  perf )
+  {
+    if ( perf->leader >= 0 )
+      ioctl( perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+  }
 
-    free( advances );
 
-    return done;
+  static void
+  perf_enable( bperf_t*  perf )
+  {
+    if ( perf->leader >= 0 )
+      ioctl( perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
   }
 
 
-  static int
-  test_render( btimer_t*  timer,
-               FT_Face    face,
-               void*      user_data )
+  static void
+  perf_disable( bperf_t*  perf )
   {
-    unsigned int  i;
-    int           done = 0;
+    if ( perf->leader >= 0 )
+      ioctl( perf->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+  }
 
-    FT_UNUSED( user_data );
 
+  /* read the counters into `perf->count', scaled if multiplexed */
+  static void
+  perf_read( bperf_t*  perf )
+  {
+    int  i;
 
-    FOREACH( i )
+
+    for ( i = 0; i < PERF_MAX; i++ )
     {
-      if ( FT_Load_Glyph( face, i, load_flags ) )
+      unsigned long long  data[3];  /* value, enabled, running */
+
+
+      perf->count[i] = -1;
+
+      if ( perf->fd[i] < 0                                            ||
+           read( perf->fd[i], data, sizeof ( data ) ) != sizeof ( data ) )
         continue;
 
-      TIMER_START( timer );
-      if ( !FT_Render_Glyph( face->glyph, render_mode ) )
-        done++;
-      TIMER_STOP( timer );
+      if ( data[2] )
+        perf->count[i] = (double)data[0] * (double)data[1] /
+                           (double)data[2];
+      else if ( !data[1] )
+        perf->count[i] = 0;   /* never enabled */
     }
+  }
 
-    return done;
+#else /* !FTBENCH_PERF_EVENTS */
+
+  static void
+  perf_close( bperf_t*  perf )
+  {
+    FT_UNUSED( perf );
   }
 
 
   static int
-  test_embolden( btimer_t*  timer,
-                 FT_Face    face,
-                 void*      user_data )
+  perf_open( bperf_t*  perf )
   {
-    unsigned int  i;
-    int           done = 0;
+    int  i;
 
-    FT_UNUSED( user_data );
 
+    for ( i = 0; i < PERF_MAX; i++ )
+      perf->fd[i] = -1;
+    perf->leader = -1;
 
-    FOREACH( i )
-    {
-      if ( FT_Load_Glyph( face, i, load_flags ) )
-        continue;
+    return 0;
+  }
 
-      TIMER_START( timer );
-      FT_GlyphSlot_Embolden( face->glyph );
-      done++;
-      TIMER_STOP( timer );
-    }
 
-    return done;
+  static void
+  perf_reset( bperf_t*  perf )
+  {
+    FT_UNUSED( perf );
   }
 
 
-  static int
-  test_stroke( btimer_t*  timer,
-               FT_Face    face,
-               void*      user_data )
+  static void
+  perf_enable( bperf_t*  perf )
   {
-    FT_Glyph      glyph;
-    FT_Stroker    stroker;
-    unsigned int  i;
-    int           done = 0;
+    FT_UNUSED( perf );
+  }
 
-    FT_UNUSED( user_data );
 
+  static void
+  perf_disable( bperf_t*  perf )
+  {
+    FT_UNUSED( perf );
+  }
 
-    FT_Stroker_New( lib, &stroker );
-    FT_Stroker_Set( stroker, face->size->metrics.y_ppem,
-                    FT_STROKER_LINECAP_ROUND,
-                    FT_STROKER_LINEJOIN_ROUND,
-                    0 );
 
-    FOREACH( i )
-    {
-      if ( FT_Load_Glyph( face, i, load_flags ) )
-        continue;
+  static void
+  perf_read( bperf_t*  perf )
+  {
+    int  i;
 
-      if ( FT_Get_Glyph( face->glyph, &glyph ) )
-        continue;
 
-      TIMER_START( timer );
-      FT_Glyph_Stroke( &glyph, stroker, 1 );
-      TIMER_STOP( timer );
+    for ( i = 0; i < PERF_MAX; i++ )
+      perf->count[i] = -1;
+  }
 
-      FT_Done_Glyph( glyph );
-      done++;
-    }
+#endif /* !FTBENCH_PERF_EVENTS */
 
-    return done;
-  }
 
+#ifdef FTBENCH_THREADS
 
-  static int
-  test_get_glyph( btimer_t*  timer,
-                  FT_Face    face,
-                  void*      user_data )
+  /* add the counts of `other' to `perf' */
+  static void
+  perf_merge( bperf_t*  perf,
+              bperf_t*  other )
   {
-    FT_Glyph      glyph;
-    unsigned int  i;
-    int           done = 0;
-
-    FT_UNUSED( user_data );
+    int  i;
 
 
-    FOREACH( i )
+    for ( i = 0; i < PERF_MAX; i++ )
     {
-      if ( FT_Load_Glyph( face, i, load_flags ) )
-        continue;
-
-      TIMER_START( timer );
-      if ( !FT_Get_Glyph( face->glyph, &glyph ) )
-      {
-        FT_Done_Glyph( glyph );
-        done++;
-      }
-      TIMER_STOP( timer );
+      if ( other->count[i] < 0 )
+        perf->count[i] = -1;
+      else if ( perf->count[i] >= 0 )
+        perf->count[i] += other->count[i];
     }
-
-    return done;
   }
 
+#endif /* FTBENCH_THREADS */
 
-  static int
-  test_get_cbox( btimer_t*  timer,
-                 FT_Face    face,
-                 void*      user_data )
-  {
-    FT_Glyph      glyph;
-    FT_BBox       bbox;
-    unsigned int  i;
-    int           done = 0;
-
-    FT_UNUSED( user_data );
 
+  /*
+   * Allocation accounting (option `-a'): libraries get created with an
+   * `FT_Memory' object that counts all calls.  Since each thread uses its
+   * own library, the counters need no locking.
+   */
 
-    FOREACH( i )
-    {
-      if ( FT_Load_Glyph( face, i, load_flags ) )
-        continue;
+  static int  count_allocs;
 
-      if ( FT_Get_Glyph( face->glyph, &glyph ) )
-        continue;
+  /* the block size is stored in front of each block; */
+  /* 16 bytes keep the alignment of `malloc'          */
+#define MEM_HEADER  16
 
-      TIMER_START( timer );
-      FT_Glyph_Get_CBox( glyph, FT_GLYPH_BBOX_PIXELS, &bbox );
-      TIMER_STOP( timer );
+  static THREAD_LOCAL struct FT_MemoryRec_  counting_memory;
 
-      FT_Done_Glyph( glyph );
-      done++;
-    }
+  /* bytes currently allocated by the thread's library, and the maximum */
+  static THREAD_LOCAL double  mem_live;
+  static THREAD_LOCAL double  mem_peak;
 
-    return done;
-  }
+  /* non-NULL while a timed section with allocation accounting is open */
+  static THREAD_LOCAL bmem_t*  mem_timed;
 
 
-  static int
-  test_get_bbox( btimer_t*  timer,
-                 FT_Face    face,
-                 void*      user_data )
+  static void
+  mem_update( long  delta )
   {
-    FT_BBox       bbox;
-    unsigned int  i;
-    int           done  = 0;
-    FT_Matrix     rot30 = { 0xDDB4, -0x8000, 0x8000, 0xDDB4 };
-
-    FT_UNUSED( user_data );
-
+    mem_live += delta;
+    if ( mem_live > mem_peak )
+      mem_peak = mem_live;
+  }
 
-    FOREACH( i )
-    {
-      FT_Outline*  outline;
 
+  static void*
+  counting_alloc( FT_Memory  memory,
+                  long       size )
+  {
+    char*  block;
 
-      if ( FT_Load_Glyph( face, i, load_flags ) )
-        continue;
+    FT_UNUSED( memory );
 
-      outline = &face->glyph->outline;
 
-      /* rotate outline by 30 degrees */
-      FT_Outline_Transform( outline, &rot30 );
+    block = (char*)malloc( (size_t)size + MEM_HEADER );
+    if ( !block )
+      return NULL;
 
-      TIMER_START( timer );
-      FT_Outline_Get_BBox( outline, &bbox );
-      TIMER_STOP( timer );
+    *(long*)block = size;
+    mem_update( size );
 
-      done++;
+    if ( mem_timed )
+    {
+      mem_timed->allocs++;
+      mem_timed->bytes += size;
     }
 
-    return done;
+    return block + MEM_HEADER;
   }
 
 
-  static int
-  test_get_char_index( btimer_t*  timer,
-                       FT_Face    face,
-                       void*      user_data )
+  static void
+  counting_free( FT_Memory  memory,
+                 void*      block )
   {
-    bcharset_t*  charset = (bcharset_t*)user_data;
-    int          i, done = 0;
+    char*  p = (char*)block - MEM_HEADER;
 
+    FT_UNUSED( memory );
 
-    TIMER_START( timer );
 
-    for ( i = 0; i < charset->size; i++ )
-    {
-      if ( FT_Get_Char_Index(face, charset->code[i]) )
-        done++;
-    }
+    mem_update( -*(long*)p );
 
-    TIMER_STOP( timer );
+    if ( mem_timed )
+      mem_timed->frees++;
 
-    return done;
+    free( p );
   }
 
 
-  static int
-  test_cmap_cache( btimer_t*  timer,
-                   FT_Face    face,
-                   void*      user_data )
+  /* a reallocation counts as an allocation of `new_size' bytes */
+  static void*
+  counting_realloc( FT_Memory  memory,
+                    long       cur_size,
+                    long       new_size,
+                    void*      block )
   {
-    bcharset_t*  charset = (bcharset_t*)user_data;
-    int          i, done = 0;
+    char*  p;
+    long   size;
 
-    FT_UNUSED( face );
+    FT_UNUSED( cur_size );
 
 
-    if ( !cmap_cache )
-    {
-      if ( FTC_CMapCache_New( cache_man, &cmap_cache ) )
-        return 0;
-    }
+    if ( !block )
+      return counting_alloc( memory, new_size );
 
-    TIMER_START( timer );
+    p    = (char*)block - MEM_HEADER;
+    size = *(long*)p;
 
-    for ( i = 0; i < charset->size; i++ )
+    p = (char*)realloc( p, (size_t)new_size + MEM_HEADER );
+    if ( !p )
+      return NULL;
+
+    *(long*)p = new_size;
+    mem_update( new_size - size );
+
+    if ( mem_timed )
     {
-      if ( FTC_CMapCache_Lookup( cmap_cache,
-                                 font_type.face_id,
-                                 0,
-                                 charset->code[i] ) )
-        done++;
+      mem_timed->allocs++;
+      mem_timed->bytes += new_size;
     }
 
-    TIMER_STOP( timer );
-
-    return done;
+    return p + MEM_HEADER;
   }
 
 
-  static int
-  test_image_cache( btimer_t*  timer,
-                    FT_Face    face,
-                    void*      user_data )
+  /* create a library object, with allocation accounting if requested */
+  static FT_Error
+  new_library( FT_Library*  alibrary )
   {
-    FT_Glyph      glyph;
-    unsigned int  i;
-    int           done = 0;
+    FT_Error  error;
 
-    FT_UNUSED( face );
-    FT_UNUSED( user_data );
 
+    if ( !count_allocs )
+      return FT_Init_FreeType( alibrary );
 
-    if ( !image_cache )
+    /* further libraries of the thread (test `s') add to the counters */
+    if ( !counting_memory.alloc )
     {
-      if ( FTC_ImageCache_New( cache_man, &image_cache ) )
-        return 0;
+      counting_memory.user    = NULL;
+      counting_memory.alloc   = counting_alloc;
+      counting_memory.free    = counting_free;
+      counting_memory.realloc = counting_realloc;
+
+      mem_live  = 0;
+      mem_peak  = 0;
+      mem_timed = NULL;
     }
 
-    TIMER_START( timer );
-
-    FOREACH( i )
-    {
-      if ( !FTC_ImageCache_Lookup( image_cache,
-                                   &font_type,
-                                   i,
-                                   &glyph,
-                                   NULL ) )
-        done++;
-    }
+    error = FT_New_Library( &counting_memory, alibrary );
+    if ( error )
+      return error;
 
-    TIMER_STOP( timer );
+    FT_Add_Default_Modules( *alibrary );
+    FT_Set_Default_Properties( *alibrary );
 
-    return done;
+    return FT_Err_Ok;
   }
 
 
-  static int
-  test_sbit_cache( btimer_t*  timer,
-                   FT_Face    face,
-                   void*      user_data )
+  static void
+  done_library( FT_Library  library )
   {
-    FTC_SBit      glyph;
-    unsigned int  i;
-    int           done = 0;
+    /* `FT_Done_FreeType' would also free our static `FT_Memory' object */
+    if ( count_allocs )
+      FT_Done_Library( library );
+    else
+      FT_Done_FreeType( library );
+  }
 
-    FT_UNUSED( face );
-    FT_UNUSED( user_data );
 
+#ifdef FTBENCH_THREADS
 
-    if ( !sbit_cache )
-    {
-      if ( FTC_SBitCache_New( cache_man, &sbit_cache ) )
-        return 0;
-    }
+  /* add the counts of `other' to `mem' */
+  static void
+  mem_merge( bmem_t*  mem,
+             bmem_t*  other )
+  {
+    mem->allocs += other->allocs;
+    mem->frees  += other->frees;
+    mem->bytes  += other->bytes;
+    mem->peak   += other->peak;
+  }
 
-    TIMER_START( timer );
+#endif /* FTBENCH_THREADS */
 
-    FOREACH( i )
-    {
-      if ( !FTC_SBitCache_Lookup( sbit_cache,
-                                  &font_type,
-                                  i,
-                                  &glyph,
-                                  NULL ) )
-        done++;
-    }
 
-    TIMER_STOP( timer );
+  /*
+   * Counters are enabled before taking the start time and disabled after
+   * taking the end time, so that the timings don't include the cost of
+   * the necessary system calls.
+   */
 
-    return done;
+  static void
+  timer_start( btimer_t*  timer )
+  {
+    if ( timer->perf )
+      perf_enable( timer->perf );
+    if ( timer->mem )
+      mem_timed = timer->mem;
+
+    timer->t0 = timer_clock();
   }
 
 
-  static int
-  test_cmap_iter( btimer_t*  timer,
-                  FT_Face    face,
-                  void*      user_data )
+  static void
+  timer_stop( btimer_t*  timer,
+              int        n )
   {
-    FT_UInt   idx;
-    FT_ULong  charcode;
+    double  delta = timer_clock() - timer->t0 - timer_overhead;
 
-    FT_UNUSED( user_data );
 
+    /* the overhead is only a median value, so a very short section */
+    /* can come out negative                                         */
+    if ( delta < 0 )
+      delta = 0;
 
-    TIMER_START( timer );
+    if ( timer->perf )
+      perf_disable( timer->perf );
+    if ( timer->mem )
+      mem_timed = NULL;
 
-    charcode = FT_Get_First_Char( face, &idx );
-    while ( idx != 0 )
-      charcode = FT_Get_Next_Char( face, charcode, &idx );
+    timer->total += delta;
+    if ( timer->histo && n > 0 )
+      histo_add( timer->histo, delta / n, n );
+  }
 
-    TIMER_STOP( timer );
 
-    return 1;
-  }
+  /* Use `TIMER_STOP_N' if the timed section covers `n' operations; */
+  /* the latency histogram then receives `n' samples of the average  */
+  /* duration.                                                       */
+#define TIMER_START( timer )      timer_start( timer )
+#define TIMER_STOP( timer )       timer_stop( ( timer ), 1 )
+#define TIMER_STOP_N( timer, n )  timer_stop( ( timer ), ( n ) )
+#define TIMER_GET( timer )        ( timer )->total
+#define TIMER_RESET( timer )      ( ( timer )->total     = 0, \
+                                    ( timer )->lookups   = 0, \
+                                    ( timer )->misses    = 0, \
+                                    ( timer )->locks     = 0, \
+                                    ( timer )->lock_wait = 0, \
+                                    ( timer )->lock_hold = 0 )
 
 
-  static int
-  test_new_face( btimer_t*  timer,
-                 FT_Face    face,
-                 void*      user_data )
-  {
-    FT_Face  bench_face;
+  typedef struct  branked_t_ {
+    double  value;
+    int     group;
 
-    FT_UNUSED( face );
-    FT_UNUSED( user_data );
+  } branked_t;
 
 
-    TIMER_START( timer );
-
-    if ( !get_face( &bench_face ) )
-      FT_Done_Face( bench_face );
-
-    TIMER_STOP( timer );
-
-    return 1;
+  static int
+  compare_ranked( const void*  a,
+                  const void*  b )
+  {
+    return bench_compare_doubles( &( (const branked_t*)a )->value,
+                                  &( (const branked_t*)b )->value );
   }
 
 
-  static int
-  test_new_face_and_load_glyph( btimer_t*  timer,
-                                FT_Face    face,
-                                void*      user_data )
+  /*
+   * Mann-Whitney U test (normal approximation with tie and continuity
+   * correction).  Return the z score of `b' against `a'; a positive
+   * value means that values in `b' tend to be larger.
+   */
+
+  static double
+  mann_whitney_z( const double*  a,
+                  int            na,
+                  const double*  b,
+                  int            nb )
   {
-    FT_Face  bench_face;
+    branked_t*  v;
+    int         n = na + nb;
+    int         i, j;
+    double      rank_b = 0, ties = 0;
+    double      u, mean, var;
 
-    unsigned int  i;
-    int           done = 0;
 
-    FT_UNUSED( face );
-    FT_UNUSED( user_data );
+    if ( !na || !nb )
+      return 0;
 
+    v = (branked_t*)malloc( (size_t)n * sizeof ( branked_t ) );
+    if ( !v )
+      return 0;
 
-    TIMER_START( timer );
+    for ( i = 0; i < na; i++ )
+    {
+      v[i].value = a[i];
+      v[i].group = 0;
+    }
+    for ( i = 0; i < nb; i++ )
+    {
+      v[na + i].value = b[i];
+      v[na + i].group = 1;
+    }
+
+    qsort( v, (size_t)n, sizeof ( branked_t ), compare_ranked );
 
-    if ( !get_face( &bench_face ) )
+    /* assign average ranks to runs of equal values */
+    for ( i = 0; i < n; i = j )
     {
-      FOREACH( i )
-      {
-        if ( !FT_Load_Glyph( bench_face, i, load_flags ) )
-          done++;
-      }
+      double  t, rank;
+      int     k;
 
-      FT_Done_Face( bench_face );
+
+      for ( j = i + 1; j < n && v[j].value == v[i].value; j++ )
+        ;
+
+      t    = j - i;
+      rank = ( i + j + 1 ) / 2.0;
+      if ( t > 1 )
+        ties += t * t * t - t;
+
+      for ( k = i; k < j; k++ )
+        if ( v[k].group )
+          rank_b += rank;
     }
 
-    TIMER_STOP( timer );
+    free( v );
 
-    return done;
+    u    = rank_b - nb * ( nb + 1 ) / 2.0;
+    mean = na * (double)nb / 2;
+    var  = na * (double)nb / 12 *
+             ( ( n + 1 ) - ties / ( (double)n * ( n - 1 ) ) );
+
+    if ( var <= 0 )
+      return 0;
+
+    if ( u > mean )
+      return ( u - mean - 0.5 ) / sqrt( var );
+    else if ( u < mean )
+      return ( u - mean + 0.5 ) / sqrt( var );
+    else
+      return 0;
   }
 
 
   /*
-   * main
+   * Baselines
    */
 
-  static void
-  get_charset( FT_Face      face,
-               bcharset_t*  charset )
+  typedef struct  bbaseline_t_ {
+    char*    title;
+    int      threads;
+    int      count;
+    double*  value;
+
+  } bbaseline_t;
+
+
+  typedef struct  bbaselines_t_ {
+    bbaseline_t*  entries;
+    int           num_entries;
+    int           max_entries;
+
+  } bbaselines_t;
+
+
+  /* the verdict of comparing a result against its baseline */
+  enum {
+    VERDICT_NONE,         /* no comparison requested */
+    VERDICT_NO_BASELINE,
+    VERDICT_SAME,
+    VERDICT_REGRESSION,
+    VERDICT_IMPROVEMENT
+  };
+
+  static const char*  verdict_names[] =
   {
-    FT_ULong  charcode;
-    FT_UInt   gindex;
-    int       i = 0;
+    NULL,
+    "no baseline",
+    "no significant change",
+    "regression",
+    "improvement"
+  };
 
 
-    charset->code = (FT_ULong*)calloc( (size_t)face->num_glyphs,
-                                       sizeof ( FT_ULong ) );
-    if ( !charset->code )
-      return;
+  typedef struct  bcompare_t_ {
+    int     verdict;
+    double  change;   /* relative change of the median */
+    double  p_value;
 
-    if ( face->charmap )
+  } bcompare_t;
+
+
+#define ALPHA  0.01  /* significance level */
+
+  static char*         save_baseline_file;
+  static char*         compare_baseline_file;
+  static double        regression_threshold = 2.0;  /* in percent */
+  static int           num_regressions;
+  static bbaselines_t  recorded, reference;
+
+
+  static bbaseline_t*
+  baseline_new( bbaselines_t*  baselines,
+                const char*    title,
+                int            threads,
+                int            count )
+  {
+    bbaseline_t*  entry;
+
+
+    if ( baselines->num_entries == baselines->max_entries )
     {
-      charcode = FT_Get_First_Char( face, &gindex );
+      int           max = baselines->max_entries * 2 + 16;
+      bbaseline_t*  entries;
 
-      /* certain fonts contain a broken charmap that will map character */
-      /* codes to out-of-bounds glyph indices.  Take care of that here. */
-      /*                                                                */
-      while ( gindex && i < face->num_glyphs )
-      {
-        if ( ( first_index <= gindex && gindex <= last_index ) ||
-             ( first_index >= gindex && gindex >= last_index ) )
-          charset->code[i++] = charcode;
-        charcode = FT_Get_Next_Char( face, charcode, &gindex );
-      }
+
+      entries = (bbaseline_t*)realloc( baselines->entries,
+                                       (size_t)max * sizeof ( *entries ) );
+      if ( !entries )
+        return NULL;
+
+      baselines->entries     = entries;
+      baselines->max_entries = max;
     }
-    else
+
+    entry          = baselines->entries + baselines->num_entries;
+    entry->title   = ft_strdup( title );
+    entry->threads = threads;
+    entry->count   = count;
+    entry->value   = (double*)calloc( (size_t)count + 1, sizeof ( double ) );
+
+    if ( !entry->title || !entry->value )
     {
-      unsigned int  j;
+      free( entry->title );
+      free( entry->value );
 
+      return NULL;
+    }
 
-      /* no charmap, do an identity mapping */
-      FOREACH( j )
-        charset->code[i++] = j;
+    baselines->num_entries++;
+
+    return entry;
+  }
+
+
+  static bbaseline_t*
+  baseline_find( bbaselines_t*  baselines,
+                 const char*    title,
+                 int            threads )
+  {
+    int  i;
+
+
+    for ( i = 0; i < baselines->num_entries; i++ )
+    {
+      bbaseline_t*  entry = baselines->entries + i;
+
+
+      if ( entry->threads == threads && !strcmp( entry->title, title ) )
+        return entry;
     }
 
-    charset->size = i;
+    return NULL;
   }
 
 
-  static FT_Error
-  get_face( FT_Face*  face )
+  static void
+  baseline_free( bbaselines_t*  baselines )
   {
-    static unsigned char*  memory_file = NULL;
-    static size_t          memory_size;
-    int                    face_index = 0;
-    FT_Error               error;
+    int  i;
 
 
-    if ( preload )
+    for ( i = 0; i < baselines->num_entries; i++ )
     {
-      if ( !memory_file )
-      {
-        FILE*  file = fopen( filename, "rb" );
+      free( baselines->entries[i].title );
+      free( baselines->entries[i].value );
+    }
+    free( baselines->entries );
 
+    baselines->entries     = NULL;
+    baselines->num_entries = 0;
+    baselines->max_entries = 0;
+  }
 
-        if ( file == NULL )
-        {
-          fprintf( stderr, "couldn't find or open `%s'\n", filename );
 
-          return 1;
-        }
+  /*
+   * A baseline file contains one line per test: the title, the number of
+   * threads, the number of samples, and the samples themselves, separated
+   * by tabs and spaces.  Lines starting with `#' are comments.
+   */
 
-        fseek( file, 0, SEEK_END );
-        memory_size = (size_t)ftell( file );
-        fseek( file, 0, SEEK_SET );
+  static int
+  baseline_load( bbaselines_t*  baselines,
+                 const char*    name )
+  {
+    FILE*  file = fopen( name, "r" );
+    char   title[256];
+    int    c;
 
-        memory_file = (FT_Byte*)malloc( memory_size );
-        if ( memory_file == NULL )
-        {
-          fprintf( stderr,
-                   "couldn't allocate memory to pre-load font file\n" );
 
-          return 1;
-        }
+    if ( !file )
+    {
+      fprintf( stderr, "couldn't open baseline file `%s'\n", name );
 
-        if ( !fread( memory_file, memory_size, 1, file ) )
-        {
-          fprintf( stderr, "read error\n" );
-          free( memory_file );
-          memory_file = NULL;
+      return 1;
+    }
 
-          return 1;
-        }
+    while ( ( c = getc( file ) ) != EOF )
+    {
+      bbaseline_t*  entry;
+      size_t        len = 0;
+      int           threads, count, i;
+
+
+      if ( c == '#' || c == '\n' )
+      {
+        while ( c != '\n' && c != EOF )
+          c = getc( file );
+        continue;
       }
 
-      error = FT_New_Memory_Face( lib,
-                                  memory_file,
-                                  (FT_Long)memory_size,
-                                  face_index,
-                                  face );
+      while ( c != '\t' && c != '\n' && c != EOF )
+      {
+        if ( len < sizeof ( title ) - 1 )
+          title[len++] = (char)c;
+        c = getc( file );
+      }
+      title[len] = '\0';
+
+      if ( c != '\t'                                       ||
+           fscanf( file, "%d %d", &threads, &count ) != 2 ||
+           count < 0                                      )
+        goto Fail;
+
+      entry = baseline_new( baselines, title, threads, count );
+      if ( !entry )
+        goto Fail;
+
+      for ( i = 0; i < count; i++ )
+        if ( fscanf( file, "%lf", &entry->value[i] ) != 1 )
+          goto Fail;
     }
-    else
-      error = FT_New_Face( lib, filename, face_index, face );
 
-    if ( error )
-      fprintf( stderr, "couldn't load font resource\n");
+    fclose( file );
 
-    return error;
+    return 0;
+
+  Fail:
+    fprintf( stderr, "invalid baseline file `%s'\n", name );
+    fclose( file );
+
+    return 1;
   }
 
 
-  static void
-  usage( void )
+  static int
+  baseline_save( bbaselines_t*  baselines,
+                 const char*    name )
   {
-    int   i;
-    char  interpreter_versions[32];
-    char  hinting_engines[32];
-
+    FILE*  file = fopen( name, "w" );
+    int    i, j;
 
-    /* we expect that at least one interpreter version is available */
-    if ( num_tt_interpreter_versions == 2 )
-      snprintf( interpreter_versions, sizeof ( interpreter_versions ),
-                "%u and %u",
-                tt_interpreter_versions[0],
-                tt_interpreter_versions[1] );
-    else
-      snprintf( interpreter_versions, sizeof ( interpreter_versions ),
-                "%u, %u, and %u",
-                tt_interpreter_versions[0],
-                tt_interpreter_versions[1],
-                tt_interpreter_versions[2] );
 
-    /* we expect that at least one hinting engine is available */
-    if ( num_ps_hinting_engines == 1 )
-      snprintf( hinting_engines, sizeof ( hinting_engines ),
-                "`%s'",
-                ps_hinting_engine_names[ps_hinting_engines[0]] );
-    else
-      snprintf( hinting_engines, sizeof ( hinting_engines ),
-                "`%s' and `%s'",
-                ps_hinting_engine_names[ps_hinting_engines[0]],
-                ps_hinting_engine_names[ps_hinting_engines[1]] );
+    if ( !file )
+    {
+      fprintf( stderr, "couldn't create baseline file `%s'\n", name );
 
+      return 1;
+    }
 
-    fprintf( stderr,
-      "\n"
-      "ftbench: run FreeType benchmarks\n"
-      "--------------------------------\n"
-      "\n"
-      "Usage: ftbench [options] fontname\n"
-      "\n"
-      "  -C        Compare with cached version (if available).\n"
-      "  -c N      Use at most N iterations for each test\n"
-      "            (0 means time limited).\n"
-      "  -f L      Use hex number L as load flags (see `FT_LOAD_XXX').\n"
-      "  -H NAME   Use PS hinting engine NAME.\n"
-      "            Available versions are %s; default is `%s'.\n"
-      "  -I VER    Use TT interpreter version VER.\n"
-      "            Available versions are %s; default is version %u.\n"
-      "  -i I-J    Forward or reverse range of glyph indices to use\n"
-      "            (default is from 0 to the number of glyphs minus one).\n"
-      "  -l N      Set LCD filter to N\n"
-      "              0: none, 1: default, 2: light, 16: legacy\n"
-      "  -m M      Set maximum cache size to M KiByte (default is %d).\n",
-             hinting_engines,
-             ps_hinting_engine_names[dflt_ps_hinting_engine],
-             interpreter_versions,
-             dflt_tt_interpreter_version,
-             CACHE_SIZE );
-    fprintf( stderr,
-      "  -p        Preload font file in memory.\n"
-      "  -r N      Set render mode to N\n"
-      "              0: normal, 1: light, 2: mono, 3: LCD, 4: LCD vertical\n"
-      "            (default is 0).\n"
-      "  -s S      Use S ppem as face size (default is %dppem).\n"
-      "            If set to zero, don't call FT_Set_Pixel_Sizes.\n"
-      "            Use value 0 with option `-f 1' or something similar to\n"
-      "            load the glyphs unscaled, otherwise errors will show up.\n",
-             FACE_SIZE );
-    fprintf( stderr,
-      "  -t T      Use at most T seconds per bench (default is %.0f).\n"
-      "\n"
-      "  -b tests  Perform chosen tests (default is all):\n",
-             BENCH_TIME );
+    fprintf( file, "# ftbench baseline for font `%s'\n", filename );
 
-    for ( i = 0; i < N_FT_BENCH; i++ )
+    for ( i = 0; i < baselines->num_entries; i++ )
     {
-      if ( !bench_desc[i] )
-        break;
+      bbaseline_t*  entry = baselines->entries + i;
 
-      fprintf( stderr,
-      "              %c  %s\n", 'a' + i, bench_desc[i] );
+
+      fprintf( file, "%s\t%d %d",
+               entry->title, entry->threads, entry->count );
+      for ( j = 0; j < entry->count; j++ )
+        fprintf( file, " %.6g", entry->value[j] );
+      fprintf( file, "\n" );
     }
 
-    fprintf( stderr,
-      "\n"
-      "  -v        Show version.\n"
-      "\n" );
+    fclose( file );
 
-    exit( 1 );
+    return 0;
   }
 
 
-#define TEST( x ) ( !test_string || strchr( test_string, (x) ) )
-
-
-  int
-  main( int     argc,
-        char**  argv )
+  /* record `samples' for saving, and compare them with the reference */
+  static void
+  baseline_check( const char*  title,
+                  int          threads,
+                  bsamples_t*  samples,
+                  bcompare_t*  cmp )
   {
-    FT_Face   face;
-    FT_Error  error;
-
-    unsigned long  max_bytes      = CACHE_SIZE * 1024;
-    char*          test_string    = NULL;
-    unsigned int   size           = FACE_SIZE;
-    int            max_iter       = 0;
-    double         max_time       = BENCH_TIME;
-    int            compare_cached = 0;
-    size_t         i;
-    int            j;
+    bbaseline_t*  entry;
 
-    unsigned int  versions[3] = { TT_INTERPRETER_VERSION_35,
-                                  TT_INTERPRETER_VERSION_38,
-                                  TT_INTERPRETER_VERSION_40 };
-    unsigned int  engines[2]  = { FT_HINTING_FREETYPE,
-                                  FT_HINTING_ADOBE };
-    int           version;
-    char         *engine;
 
-#if defined _WIN32 && defined QPC
-    LARGE_INTEGER  freq;
+    cmp->verdict = VERDICT_NONE;
 
-    QueryPerformanceFrequency( &freq );
-    interval = 1e6 / freq.QuadPart;
-#endif
+    if ( save_baseline_file )
+    {
+      entry = baseline_new( &recorded, title, threads, samples->count );
+      if ( entry )
+        memcpy( entry->value,
+                samples->value,
+                (size_t)samples->count * sizeof ( double ) );
+    }
 
+    if ( !compare_baseline_file )
+      return;
 
-    if ( FT_Init_FreeType( &lib ) )
+    entry = baseline_find( &reference, title, threads );
+    if ( !entry || !entry->count || !samples->count )
     {
-      fprintf( stderr, "could not initialize font library\n" );
+      cmp->verdict = VERDICT_NO_BASELINE;
 
-      return 1;
+      return;
     }
 
+    {
+      double  old_median = bench_median( entry->value, entry->count );
+      double  new_median = bench_median( samples->value, samples->count );
+      double  z          = mann_whitney_z( entry->value, entry->count,
+                                           samples->value, samples->count );
 
-    /* collect all available versions, then set again the default */
+
+      /* one-sided p-value in the direction of the observed shift */
+      cmp->change  = old_median > 0 ? new_median / old_median - 1 : 0;
+      cmp->p_value = 0.5 * erfc( fabs( z ) / sqrt( 2.0 ) );
+
+      if ( cmp->p_value < ALPHA                     &&
+           z > 0                                    &&
+           100 * cmp->change > regression_threshold )
+      {
+        cmp->verdict = VERDICT_REGRESSION;
+        num_regressions++;
+      }
+      else if ( cmp->p_value < ALPHA                      &&
+                z < 0                                     &&
+                -100 * cmp->change > regression_threshold )
+        cmp->verdict = VERDICT_IMPROVEMENT;
+      else
+        cmp->verdict = VERDICT_SAME;
+    }
+  }
+
+
+  /*
+   * Output
+   */
+
+  enum {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_CSV
+  };
+
+  static int  output_format = FORMAT_TEXT;
+  static int  num_results;
+
+
+  typedef struct  bresult_t_ {
+    const char*  title;
+    const char*  status;      /* why the test didn't run, or NULL */
+    int          threads;     /* zero if not in multi-threaded mode */
+    int          done;
+    double       time;        /* sum of all timed sections, in us */
+    double       wall;        /* elapsed wall-clock time, in us */
+    double       efficiency;  /* relative to a single thread */
+    bhisto_t*    histo;
+    bsamples_t*  samples;
+    bperf_t*     perf;
+    bmem_t*      mem;
+    bio_t*       io;
+    double       lookups;     /* cache statistics, if any */
+    double       misses;
+    const char*  lookup_unit;
+    double       locks;       /* shared cache mutex statistics, if any */
+    double       lock_wait;
+    double       lock_hold;
+    int          repeats;     /* number of repetitions, if more than 1 */
+    int          rejected;    /* repetitions rejected as outliers */
+    double       us_per_op;   /* average of the kept repetitions */
+    double       ci;          /* half width of 95% conf. interval, in % */
+
+  } bresult_t;
+
+
+  /* settings reported along with the results */
+  typedef struct  binfo_t_ {
+    char          version[32];
+    const char*   engine;
+    int           interpreter;
+    int           max_iter;
+    double        max_time;
+    const char*   family;
+    const char*   style;
+    unsigned int  first_index;
+    unsigned int  last_index;
+    int           num_fonts;    /* corpus mode only */
+    int           num_files;
+    int           num_workers;
+
+  } binfo_t;
+
+  static binfo_t  info;
+
+
+  /* print a quoted string, escaped according to `output_format' */
+  static void
+  print_string( const char*  s )
+  {
+    bench_print_string( s, output_format == FORMAT_CSV );
+  }
+
+
+  /* print the leading CSV columns: font and settings */
+  static void
+  print_csv_settings( const char*  font,
+                      const char*  family,
+                      const char*  style )
+  {
+    print_string( info.version );
+    putchar( ',' );
+    print_string( font );
+    putchar( ',' );
+    print_string( family );
+    putchar( ',' );
+    print_string( style );
+    printf( ",%d,%g,%u,%u,%u,%d,",
+            info.max_iter,
+            info.max_time,
+            info.first_index,
+            info.last_index,
+            face_size,
+            preload != 0 );
+    print_string( preload_mode );
+    printf( ",%d,%d,%d,",
+            cold_cache,
+            load_flags,
+            render_mode );
+    if ( lcd_filter_set )
+      printf( "%d", lcd_filter );
+    putchar( ',' );
+    print_string( info.engine );
+    printf( ",%d,%lu,", info.interpreter, max_bytes / 1024 );
+  }
+
+
+  /* `face' is NULL in corpus mode */
+  static void
+  report_begin( FT_Face  face )
+  {
+    size_t  i;
+
+
+    if ( face )
+    {
+      info.family      = face->family_name;
+      info.style       = face->style_name;
+      info.first_index = first_index;
+      info.last_index  = last_index;
+    }
+    else
+    {
+      info.first_index = range_first;
+      info.last_index  = range_last;
+    }
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "{\n"
+              "  \"freetype\": \"%s\",\n",
+              info.version );
+      if ( face )
+      {
+        printf( "  \"font\": " );
+        print_string( filename );
+        printf( ",\n"
+                "  \"family\": " );
+        print_string( info.family );
+        printf( ",\n"
+                "  \"style\": " );
+        print_string( info.style );
+        printf( ",\n" );
+      }
+      else
+        printf( "  \"fonts\": %d,\n"
+                "  \"files\": %d,\n"
+                "  \"workers\": %d,\n",
+                info.num_fonts,
+                info.num_files,
+                info.num_workers );
+      printf( "  \"options\": {\n"
+              "    \"max_iter\": %d,\n"
+              "    \"max_time\": %g,\n"
+              "    \"first_index\": %u,\n"
+              "    \"last_index\": %u,\n"
+              "    \"face_size\": %u,\n"
+              "    \"preload\": %s,\n"
+              "    \"preload_mode\": \"%s\",\n"
+              "    \"cold_cache\": %s,\n"
+              "    \"load_flags\": %d,\n"
+              "    \"render_mode\": %d,\n",
+              info.max_iter,
+              info.max_time,
+              info.first_index,
+              info.last_index,
+              face_size,
+              preload ? "true" : "false",
+              preload_mode,
+              cold_cache ? "true" : "false",
+              load_flags,
+              render_mode );
+      if ( lcd_filter_set )
+        printf( "    \"lcd_filter\": %d,\n", lcd_filter );
+      else
+        printf( "    \"lcd_filter\": null,\n" );
+      printf( "    \"hinting_engine\": " );
+      print_string( info.engine );
+      printf( ",\n"
+              "    \"interpreter_version\": %d,\n"
+              "    \"cache_size\": %lu,\n",
+              info.interpreter,
+              max_bytes / 1024 );
+      if ( num_sweep_sizes )
+      {
+        printf( "    \"cache_sizes\": [" );
+        for ( i = 0; i < (size_t)num_sweep_sizes; i++ )
+          printf( "%s%lu", i ? ", " : "", sweep_sizes[i] );
+        printf( "],\n" );
+      }
+      printf( "    \"clock\": \"%s\",\n"
+              "    \"timer_overhead\": %.6g,\n",
+              clock_name,
+              timer_overhead );
+      printf( "    \"warmup\": %d,\n"
+              "    \"repetitions\": %d,\n"
+              "    \"target_ci\": %g,\n",
+              warmup_iter,
+              num_repeats,
+              target_ci );
+      if ( pin_cpu >= 0 )
+        printf( "    \"cpu\": %d,\n", pin_cpu );
+      else
+        printf( "    \"cpu\": null,\n" );
+      if ( matrix_dims )
+      {
+        printf( "    \"matrix\": " );
+        print_string( matrix_dims );
+        printf( ",\n" );
+      }
+      if ( num_ppem_sizes )
+      {
+        printf( "    \"face_sizes\": [" );
+        for ( i = 0; i < (size_t)num_ppem_sizes; i++ )
+          printf( "%s%g", i ? ", " : "", ppem_sizes[i] );
+        printf( "],\n" );
+      }
+      if ( soak_time > 0 )
+        printf( "    \"soak_time\": %g,\n"
+                "    \"soak_interval\": %g,\n",
+                soak_time,
+                soak_interval );
+      if ( ab_libs[0] )
+      {
+        printf( "    \"lib_a\": " );
+        print_string( ab_libs[0] );
+        printf( ",\n"
+                "    \"lib_a_version\": " );
+        print_string( ab_versions[0] );
+        printf( ",\n"
+                "    \"lib_b\": " );
+        print_string( ab_libs[1] );
+        printf( ",\n"
+                "    \"lib_b_version\": " );
+        print_string( ab_versions[1] );
+        printf( ",\n" );
+      }
+      printf( "    \"threads\": %d\n"
+              "  },\n"
+              "  \"results\": [\n",
+              num_threads );
+      break;
+
+    case FORMAT_CSV:
+      printf( "freetype,font,family,style,"
+              "max_iter,max_time,first_index,last_index,face_size,"
+              "preload,preload_mode,cold_cache,"
+              "load_flags,render_mode,lcd_filter,"
+              "hinting_engine,interpreter_version,cache_size," );
+      if ( face && matrix_dims )
+        printf( "test,target,autohint,status,done,us_per_op\n" );
+      else if ( face && soak_time > 0 )
+        printf( "elapsed,ops,ops_per_s,rss_bytes,heap_bytes,"
+                "rss_growing,heap_growing\n" );
+      else if ( face && num_ppem_sizes )
+        printf( "test,ppem,status,done,us_per_op,bytes_per_op\n" );
+      else if ( face && ab_libs[0] )
+        printf( "a_version,b_version,test,status,pairs,rejected,"
+                "a_us_per_op,b_us_per_op,speedup,ci_pct,verdict\n" );
+      else if ( face )
+      {
+        printf( "test,threads,status,done,us_per_op,ops_per_s,efficiency,"
+                "min,p50,p90,p99,max," );
+        for ( i = 0; i < PERF_MAX; i++ )
+          printf( "%s,", perf_names[i] );
+        printf( "hit_rate,lookups,misses,"
+                "allocs_per_op,frees_per_op,bytes_per_op,peak_bytes,"
+                "reads_per_op,seeks_per_op,read_bytes_per_op,"
+                "distinct_bytes_per_op,"
+                "repetitions,rejected,ci_pct,"
+                "baseline,change,p_value,"
+                "locks,lock_wait_us,lock_hold_us,lock_busy\n" );
+      }
+      else
+        printf( "face_index,instance,rank,status,score,font_us_per_op,"
+                "share,test,done,us_per_op,relative\n" );
+      break;
+
+    default:
+      if ( face )
+      {
+        printf( "\n"
+                "ftbench results for font `%s'\n"
+                "---------------------------",
+                filename );
+        for ( i = 0; i < strlen( filename ); i++ )
+          putchar( '-' );
+        putchar( '\n' );
+
+        printf( "\n"
+                "family: %s\n"
+                " style: %s\n"
+                "\n",
+                face->family_name,
+                face->style_name );
+      }
+      else
+        printf( "\n"
+                "ftbench results for %d fonts from %d files\n"
+                "-----------------------------------------\n"
+                "\n",
+                info.num_fonts,
+                info.num_files );
+
+      if ( info.max_iter )
+        printf( "number of iterations for each test: at most %d\n",
+                info.max_iter );
+      printf( "number of seconds for each test: %s%f\n",
+               info.max_iter ? "at most " : "",
+               info.max_time );
+      if ( num_threads > 1 )
+        printf( "number of threads for each test: 1 to %d%s\n",
+                num_threads,
+                share_caches ? " (cached tests also with shared caches)"
+                             : "" );
+      if ( !face )
+        printf( "number of worker threads: %d\n",
+                info.num_workers );
+      printf( "clock: %s (overhead of %.3f us per timed section"
+              " subtracted)\n",
+              clock_name,
+              timer_overhead );
+      if ( warmup_iter )
+        printf( "number of warm-up iterations: %d\n",
+                warmup_iter );
+      if ( ab_libs[0] )
+      {
+        printf( "A/B comparison: slices alternating in the order ABBA" );
+        if ( target_ci > 0 )
+          printf( ", until 95%% CI of speedup within +-%g%%"
+                  " (at most %g seconds)",
+                  target_ci,
+                  max_repeat_time );
+        printf( "\n" );
+      }
+      else if ( target_ci > 0 )
+        printf( "repetitions: until 95%% CI within +-%g%%"
+                " (%d to %d, at most %g seconds)\n",
+                target_ci,
+                num_repeats < 3 ? 3 : num_repeats,
+                MAX_REPEATS,
+                max_repeat_time );
+      else if ( num_repeats > 1 )
+        printf( "repetitions: %d\n", num_repeats );
+      if ( pin_cpu >= 0 )
+        printf( "pinned to CPU %d\n", pin_cpu );
+
+      printf( "\n"
+              "glyph indices: from %u to ",
+              info.first_index );
+      if ( info.last_index == ~0U )
+        printf( "the last one\n" );
+      else
+        printf( "%u\n", info.last_index );
+      if ( num_ppem_sizes )
+      {
+        printf( "face sizes (ppem):" );
+        for ( i = 0; i < (size_t)num_ppem_sizes; i++ )
+          printf( " %g", ppem_sizes[i] );
+        printf( "\n" );
+      }
+      else
+        printf( "face size: %uppem\n", face_size );
+      printf( "font preloading into memory: %s\n",
+              preload ? preload_mode : "no" );
+      if ( cold_cache )
+        printf( "page cache: dropped before opening a new face\n" );
+
+      printf( "\n"
+              "load flags: 0x%X\n"
+              "render mode: %u\n",
+              load_flags,
+              render_mode );
+      printf( "\n"
+              "CFF hinting engine set to `%s'\n"
+              "TrueType interpreter set to version %d\n",
+              info.engine,
+              info.interpreter );
+      if ( num_sweep_sizes )
+      {
+        printf( "maximum cache sizes (KiByte):" );
+        for ( i = 0; i < (size_t)num_sweep_sizes; i++ )
+          printf( " %lu", sweep_sizes[i] );
+        printf( "\n" );
+      }
+      else
+        printf( "maximum cache size: %luKiByte\n", max_bytes / 1024 );
+
+      if ( face && ( matrix_dims || soak_time > 0 || num_ppem_sizes ||
+                     ab_libs[0] ) )
+        printf( "\n" );
+      else if ( face )
+        printf( "\n"
+                "executing tests:\n" );
+      else
+        printf( "\n"
+                "fonts ranked by the geometric mean of their times per"
+                " operation\n"
+                "relative to the median of all fonts for each test:\n"
+                "\n"
+                "   rank   score      us/op   share  font\n" );
+    }
+
+    fflush( stdout );
+  }
+
+
+  /* announce the next test, to indicate progress */
+  static void
+  report_start( const char*  title )
+  {
+    if ( output_format == FORMAT_TEXT )
+    {
+      printf( "  %-25s ", title );
+      fflush( stdout );
+    }
+  }
+
+
+  static void
+  report_result( bresult_t*  r )
+  {
+    const char*  status = r->status;
+    double       us_per_op = 0, ops_per_s = 0;
+    bcompare_t   cmp;
+    int          i;
+
+
+    cmp.verdict = VERDICT_NONE;
+    cmp.change  = 0;
+    cmp.p_value = 1;
+
+    if ( !status && !r->done )
+      status = "no error-free calls";
+    if ( !status )
+    {
+      us_per_op = r->us_per_op > 0 ? r->us_per_op : r->time / r->done;
+      if ( r->wall > 0 )
+        ops_per_s = 1E6 * r->done / r->wall;
+
+      if ( r->samples )
+        baseline_check( r->title, r->threads, r->samples, &cmp );
+    }
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "%s    { \"test\": ", num_results ? ",\n" : "" );
+      print_string( r->title );
+      printf( ", \"threads\": %d, \"status\": ",
+              r->threads ? r->threads : 1 );
+      print_string( status ? status : "ok" );
+      if ( !status )
+      {
+        printf( ", \"done\": %d, \"us_per_op\": %.6g",
+                r->done, us_per_op );
+        if ( r->threads )
+          printf( ", \"ops_per_s\": %.6g, \"efficiency\": %.4g",
+                  ops_per_s, r->efficiency );
+        if ( r->histo && r->histo->total )
+          printf( ", \"min\": %.6g, \"p50\": %.6g, \"p90\": %.6g,"
+                  " \"p99\": %.6g, \"max\": %.6g",
+                  r->histo->min,
+                  histo_quantile( r->histo, 0.5 ),
+                  histo_quantile( r->histo, 0.9 ),
+                  histo_quantile( r->histo, 0.99 ),
+                  r->histo->max );
+        if ( r->perf )
+          for ( i = 0; i < PERF_MAX; i++ )
+            if ( r->perf->count[i] >= 0 )
+              printf( ", \"%s\": %.6g",
+                      perf_names[i], r->perf->count[i] / r->done );
+        if ( num_sweep_sizes )
+          printf( ", \"cache_size\": %lu", max_bytes / 1024 );
+        if ( r->lookups > 0 )
+          printf( ", \"%s_per_s\": %.6g, \"hit_rate\": %.4g,"
+                  " \"lookups\": %.0f, \"misses\": %.0f",
+                  r->lookup_unit ? r->lookup_unit : "glyphs",
+                  1E6 / us_per_op,
+                  1 - r->misses / r->lookups,
+                  r->lookups,
+                  r->misses );
+        if ( r->mem )
+          printf( ", \"allocs_per_op\": %.6g, \"frees_per_op\": %.6g,"
+                  " \"bytes_per_op\": %.6g, \"peak_bytes\": %.0f",
+                  r->mem->allocs / r->done,
+                  r->mem->frees / r->done,
+                  r->mem->bytes / r->done,
+                  r->mem->peak );
+        if ( r->io )
+          printf( ", \"reads_per_op\": %.6g, \"seeks_per_op\": %.6g,"
+                  " \"read_bytes_per_op\": %.6g,"
+                  " \"distinct_bytes_per_op\": %.6g",
+                  r->io->reads / r->done,
+                  r->io->seeks / r->done,
+                  r->io->bytes / r->done,
+                  r->io->distinct / r->done );
+        if ( r->repeats )
+        {
+          printf( ", \"repetitions\": %d, \"rejected\": %d",
+                  r->repeats, r->rejected );
+          if ( r->ci >= 0 )
+            printf( ", \"ci_pct\": %.4g", r->ci );
+        }
+        if ( cmp.verdict )
+        {
+          printf( ", \"baseline\": " );
+          print_string( verdict_names[cmp.verdict] );
+          if ( cmp.verdict != VERDICT_NO_BASELINE )
+            printf( ", \"change\": %.4g, \"p_value\": %.4g",
+                    cmp.change, cmp.p_value );
+        }
+        if ( r->locks > 0 )
+          printf( ", \"locks\": %.0f, \"lock_wait_us\": %.6g,"
+                  " \"lock_hold_us\": %.6g, \"lock_busy\": %.4g",
+                  r->locks,
+                  r->lock_wait / r->locks,
+                  r->lock_hold / r->locks,
+                  r->wall > 0 ? r->lock_hold / r->wall : 0 );
+      }
+      printf( " }" );
+      break;
+
+    case FORMAT_CSV:
+      print_csv_settings( filename, info.family, info.style );
+      print_string( r->title );
+      printf( ",%d,", r->threads ? r->threads : 1 );
+      print_string( status ? status : "ok" );
+      if ( status )
+        printf( ",,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,\n" );
+      else
+      {
+        printf( ",%d,%.6g,", r->done, us_per_op );
+        if ( r->threads )
+          printf( "%.6g,%.4g,", ops_per_s, r->efficiency );
+        else
+          printf( ",," );
+        if ( r->histo && r->histo->total )
+          printf( "%.6g,%.6g,%.6g,%.6g,%.6g,",
+                  r->histo->min,
+                  histo_quantile( r->histo, 0.5 ),
+                  histo_quantile( r->histo, 0.9 ),
+                  histo_quantile( r->histo, 0.99 ),
+                  r->histo->max );
+        else
+          printf( ",,,,," );
+        for ( i = 0; i < PERF_MAX; i++ )
+        {
+          if ( r->perf && r->perf->count[i] >= 0 )
+            printf( "%.6g", r->perf->count[i] / r->done );
+          putchar( ',' );
+        }
+        if ( r->lookups > 0 )
+          printf( "%.4g,%.0f,%.0f,",
+                  1 - r->misses / r->lookups,
+                  r->lookups,
+                  r->misses );
+        else
+          printf( ",,," );
+        if ( r->mem )
+          printf( "%.6g,%.6g,%.6g,%.0f,",
+                  r->mem->allocs / r->done,
+                  r->mem->frees / r->done,
+                  r->mem->bytes / r->done,
+                  r->mem->peak );
+        else
+          printf( ",,,," );
+        if ( r->io )
+          printf( "%.6g,%.6g,%.6g,%.6g,",
+                  r->io->reads / r->done,
+                  r->io->seeks / r->done,
+                  r->io->bytes / r->done,
+                  r->io->distinct / r->done );
+        else
+          printf( ",,,," );
+        if ( r->repeats )
+        {
+          printf( "%d,%d,", r->repeats, r->rejected );
+          if ( r->ci >= 0 )
+            printf( "%.4g", r->ci );
+          putchar( ',' );
+        }
+        else
+          printf( ",,," );
+        if ( cmp.verdict )
+        {
+          print_string( verdict_names[cmp.verdict] );
+          if ( cmp.verdict != VERDICT_NO_BASELINE )
+            printf( ",%.4g,%.4g,", cmp.change, cmp.p_value );
+          else
+            printf( ",,," );
+        }
+        else
+          printf( ",,," );
+        if ( r->locks > 0 )
+          printf( "%.0f,%.6g,%.6g,%.4g\n",
+                  r->locks,
+                  r->lock_wait / r->locks,
+                  r->lock_hold / r->locks,
+                  r->wall > 0 ? r->lock_hold / r->wall : 0 );
+        else
+          printf( ",,,\n" );
+      }
+      break;
+
+    default:
+      if ( r->threads > 1 )
+        printf( "  %-25s ", "" );
+
+      if ( status )
+        printf( "%s\n", status );
+      else if ( !r->threads )
+      {
+        printf( "%10.3f us/op %10d done\n", us_per_op, r->done );
+        if ( r->histo && r->histo->total )
+          printf( "    min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+                  r->histo->min,
+                  histo_quantile( r->histo, 0.5 ),
+                  histo_quantile( r->histo, 0.9 ),
+                  histo_quantile( r->histo, 0.99 ),
+                  r->histo->max );
+      }
+      else
+        printf( "%3d thread%s %10.3f us/op %12.0f ops/s %6.1f%%\n",
+                r->threads, r->threads == 1 ? " " : "s",
+                us_per_op,
+                ops_per_s,
+                100.0 * r->efficiency );
+
+      if ( r->perf && !status )
+      {
+        double*  c = r->perf->count;
+
+
+        if ( c[PERF_CYCLES] < 0 && c[PERF_INSTRUCTIONS] < 0 &&
+             c[PERF_L1D_MISSES] < 0 && c[PERF_LLC_MISSES] < 0 &&
+             c[PERF_BRANCH_MISSES] < 0                       )
+          printf( "    counters: not available\n" );
+        else
+        {
+          printf( "    per op:" );
+          if ( c[PERF_CYCLES] >= 0 )
+            printf( " %.0f cycles", c[PERF_CYCLES] / r->done );
+          if ( c[PERF_INSTRUCTIONS] >= 0 )
+            printf( ", %.0f instr", c[PERF_INSTRUCTIONS] / r->done );
+          if ( c[PERF_CYCLES] > 0 && c[PERF_INSTRUCTIONS] >= 0 )
+            printf( " (IPC %.2f)",
+                    c[PERF_INSTRUCTIONS] / c[PERF_CYCLES] );
+          if ( c[PERF_L1D_MISSES] >= 0 )
+            printf( ", %.1f L1d miss", c[PERF_L1D_MISSES] / r->done );
+          if ( c[PERF_LLC_MISSES] >= 0 )
+            printf( ", %.2f LLC miss", c[PERF_LLC_MISSES] / r->done );
+          if ( c[PERF_BRANCH_MISSES] >= 0 )
+            printf( ", %.1f br miss", c[PERF_BRANCH_MISSES] / r->done );
+          printf( "\n" );
+        }
+      }
+
+      if ( r->lookups > 0 && !status )
+        printf( "    %.0f %s/s, cache hit rate %.2f%%"
+                " (%.0f misses in %.0f lookups)\n",
+                1E6 / us_per_op,
+                r->lookup_unit ? r->lookup_unit : "glyphs",
+                100 * ( 1 - r->misses / r->lookups ),
+                r->misses,
+                r->lookups );
+
+      if ( r->mem && !status )
+        printf( "    per op: %.2f allocs, %.2f frees, %.0f bytes;"
+                " peak %.0f KiB\n",
+                r->mem->allocs / r->done,
+                r->mem->frees / r->done,
+                r->mem->bytes / r->done,
+                r->mem->peak / 1024 );
+
+      if ( r->io && !status )
+        printf( "    I/O per op: %.1f reads, %.1f seeks, %.0f bytes"
+                " (%.0f distinct)\n",
+                r->io->reads / r->done,
+                r->io->seeks / r->done,
+                r->io->bytes / r->done,
+                r->io->distinct / r->done );
+
+      if ( r->locks > 0 && !status )
+        printf( "    lock: %.0f acquisitions, wait %.3f us, hold %.3f us;"
+                " held %.1f%% of the time\n",
+                r->locks,
+                r->lock_wait / r->locks,
+                r->lock_hold / r->locks,
+                r->wall > 0 ? 100 * r->lock_hold / r->wall : 0.0 );
+
+      if ( r->repeats && !status )
+      {
+        printf( "    %d repetitions, %d rejected",
+                r->repeats, r->rejected );
+        if ( r->ci >= 0 )
+          printf( "; 95%% CI +-%.2f%%", r->ci );
+        printf( "\n" );
+      }
+
+      if ( cmp.verdict == VERDICT_NO_BASELINE )
+        printf( "    baseline: none\n" );
+      else if ( cmp.verdict )
+        printf( "    baseline: %+.1f%% (p = %.2g), %s%s\n",
+                100 * cmp.change,
+                cmp.p_value,
+                verdict_names[cmp.verdict],
+                cmp.verdict == VERDICT_REGRESSION ? " <<<" : "" );
+    }
+
+    num_results++;
+    fflush( stdout );
+  }
+
+
+  /* report a test that can't be run */
+  static void
+  report_skip( const char*  title,
+               const char*  status )
+  {
+    bresult_t  r;
+
+
+    /* corpus mode only reports per-font results */
+    if ( current_font )
+      return;
+
+    memset( &r, 0, sizeof ( r ) );
+    r.title  = title;
+    r.status = status;
+
+    report_start( title );
+    report_result( &r );
+  }
+
+
+  static void
+  report_end( void )
+  {
+    if ( output_format == FORMAT_JSON )
+      printf( "%s  ]\n"
+              "}\n",
+              num_results ? "\n" : "" );
+  }
+
+
+  /* report a font of the corpus mode; `total' is the sum of all costs */
+  static void
+  report_font( bfont_t*  font,
+               int       rank,
+               double    total )
+  {
+    double  share = total > 0 ? font->cost / total : 0;
+    long    index = font->face_index & 0xFFFF;
+    long    inst  = font->face_index >> 16;
+    int     i;
+
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "%s    { \"rank\": %d, \"font\": ",
+              num_results ? ",\n" : "",
+              rank );
+      print_string( font->filename );
+      printf( ", \"face_index\": %ld, \"instance\": %ld, \"family\": ",
+              index,
+              inst );
+      print_string( font->family );
+      printf( ", \"style\": " );
+      print_string( font->style );
+      printf( ", \"status\": " );
+      print_string( font->status ? font->status : "ok" );
+      if ( !font->status )
+      {
+        printf( ", \"score\": %.4g, \"us_per_op\": %.6g, \"share\": %.4g,"
+                " \"tests\": [",
+                font->score,
+                font->cost,
+                share );
+        for ( i = 0; i < font->num_results; i++ )
+        {
+          bfontresult_t*  r = &font->results[i];
+
+
+          printf( "%s\n      { \"test\": ", i ? "," : "" );
+          print_string( r->title );
+          printf( ", \"done\": %d", r->done );
+          if ( r->done )
+            printf( ", \"us_per_op\": %.6g", r->time / r->done );
+          if ( r->relative > 0 )
+            printf( ", \"relative\": %.4g", r->relative );
+          printf( " }" );
+        }
+        printf( "\n    ]" );
+      }
+      printf( " }" );
+      break;
+
+    case FORMAT_CSV:
+      for ( i = 0; i < font->num_results || i == 0; i++ )
+      {
+        print_csv_settings( font->filename, font->family, font->style );
+        printf( "%ld,%ld,%d,", index, inst, rank );
+        print_string( font->status ? font->status : "ok" );
+        if ( font->status || !font->num_results )
+        {
+          printf( ",,,,,,,\n" );
+          break;
+        }
+        printf( ",%.4g,%.6g,%.4g,", font->score, font->cost, share );
+        print_string( font->results[i].title );
+        printf( ",%d,", font->results[i].done );
+        if ( font->results[i].done )
+          printf( "%.6g",
+                  font->results[i].time / font->results[i].done );
+        putchar( ',' );
+        if ( font->results[i].relative > 0 )
+          printf( "%.4g", font->results[i].relative );
+        putchar( '\n' );
+      }
+      break;
+
+    default:
+      if ( font->status )
+        printf( "  %5s %7s %10s %7s  ", "-", "-", "-", "-" );
+      else
+        printf( "  %5d %7.3f %10.3f %6.2f%%  ",
+                rank, font->score, font->cost, 100 * share );
+
+      printf( "%s %s (%s",
+              font->family ? font->family : "?",
+              font->style ? font->style : "?",
+              font->filename );
+      if ( index || inst )
+        printf( ", face %ld", index );
+      if ( inst )
+        printf( ", instance %ld", inst );
+      printf( ")" );
+      if ( font->status )
+        printf( ": %s", font->status );
+      putchar( '\n' );
+
+      for ( i = 0; !font->status && i < font->num_results; i++ )
+      {
+        bfontresult_t*  r = &font->results[i];
+
+
+        printf( "  %15s %-25s ", "", r->title );
+        if ( r->done )
+          printf( "%10.3f us/op", r->time / r->done );
+        else
+          printf( "%16s", "no error-free calls" );
+        if ( r->relative > 0 )
+          printf( " %7.2fx", r->relative );
+        putchar( '\n' );
+      }
+    }
+
+    num_results++;
+  }
+
+
+  /* finish the corpus mode report with the aggregate throughput */
+  static void
+  report_corpus_end( bfont_t*  fonts,
+                     int       count,
+                     double    wall )
+  {
+    double  done   = 0;
+    double  time   = 0;
+    int     failed = 0;
+    int     i, j;
+
+
+    for ( i = 0; i < count; i++ )
+    {
+      if ( fonts[i].status )
+        failed++;
+
+      for ( j = 0; j < fonts[i].num_results; j++ )
+      {
+        done += fonts[i].results[j].done;
+        time += fonts[i].results[j].time;
+      }
+    }
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "%s  ],\n"
+              "  \"aggregate\": { \"fonts\": %d, \"failed\": %d,"
+              " \"done\": %.0f, \"time\": %.6g, \"wall\": %.6g,"
+              " \"ops_per_s\": %.6g, \"fonts_per_s\": %.6g }\n"
+              "}\n",
+              num_results ? "\n" : "",
+              count,
+              failed,
+              done,
+              time / 1E6,
+              wall / 1E6,
+              wall > 0 ? 1E6 * done / wall : 0,
+              wall > 0 ? 1E6 * count / wall : 0 );
+      break;
+
+    case FORMAT_CSV:
+      break;
+
+    default:
+      printf( "\n"
+              "aggregate over %d fonts (%d failed):\n"
+              "  %.0f operations in %.3f s (%.0f ops/s, %.2f fonts/s)\n"
+              "  %.3f s spent in timed sections\n",
+              count,
+              failed,
+              done,
+              wall / 1E6,
+              wall > 0 ? 1E6 * done / wall : 0,
+              wall > 0 ? 1E6 * count / wall : 0,
+              time / 1E6 );
+    }
+
+    fflush( stdout );
+  }
+
+
+  /*
+   * Bench code
+   */
+
+  /* a simple, but reproducible pseudo-random number generator */
+  static FT_UInt32
+  next_random( FT_UInt32*  state )
+  {
+    FT_UInt32  x = *state;
+
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+  }
+
+
+  /* pin the calling thread to CPU `pin_cpu + offset' if requested */
+  static void
+  pin_thread( int  offset )
+  {
+#ifdef FTBENCH_AFFINITY
+    cpu_set_t  set;
+
+
+    if ( pin_cpu < 0 )
+      return;
+
+    CPU_ZERO( &set );
+    CPU_SET( pin_cpu + offset, &set );
+
+    if ( sched_setaffinity( 0, sizeof ( set ), &set ) )
+      fprintf( stderr, "warning: couldn't pin thread to CPU %d\n",
+               pin_cpu + offset );
+#else
+    FT_UNUSED( offset );
+#endif
+  }
+
+
+  /* run the untimed iterations before a test (option `-W') */
+  static void
+  bench_warmup( FT_Face   face,
+                btest_t*  test )
+  {
+    btimer_t  timer;
+    int       n;
+
+
+    timer.histo = NULL;
+    timer.perf  = NULL;
+    timer.mem   = NULL;
+    TIMER_RESET( &timer );
+
+    /* cached tests need at least one iteration to fill the cache */
+    n = warmup_iter;
+    if ( test->cache_first && !n )
+      n = 1;
+
+    while ( n-- > 0 )
+      test->bench( &timer, face, test->user_data );
+  }
+
+
+  /* reset all counters of `timer' before running a test */
+  static void
+  bench_reset( btimer_t*  timer )
+  {
+    TIMER_RESET( timer );
+
+    if ( timer->histo )
+      histo_reset( timer->histo );
+    if ( timer->perf )
+      perf_reset( timer->perf );
+    if ( timer->mem )
+    {
+      memset( timer->mem, 0, sizeof ( *timer->mem ) );
+      mem_peak = mem_live;
+    }
+  }
+
+
+  /* Run `test' until `max_iter' or `max_time' is reached.  The counters */
+  /* of `timer' are not reset, so that repetitions can accumulate them.  */
+  static int
+  bench_loop( FT_Face      face,
+              btest_t*     test,
+              btimer_t*    timer,
+              bsamples_t*  samples,
+              int          max_iter,
+              double       max_time )
+  {
+    int       n, done;
+    btimer_t  elapsed;
+
+
+    TIMER_RESET( &elapsed );
+    elapsed.histo = NULL;
+    elapsed.perf  = NULL;
+    elapsed.mem   = NULL;
+
+    bench_samples_reset( samples );
+
+    for ( n = 0, done = 0; !max_iter || n < max_iter; n++ )
+    {
+      double  t = TIMER_GET( timer );
+      int     d;
+
+
+      TIMER_START( &elapsed );
+
+      d = test->bench( timer, face, test->user_data );
+
+      TIMER_STOP( &elapsed );
+
+      bench_samples_add( samples, TIMER_GET( timer ) - t, d );
+      done += d;
+
+      if ( TIMER_GET( &elapsed ) > 1E6 * max_time )
+        break;
+    }
+
+    if ( timer->perf )
+      perf_read( timer->perf );
+    if ( timer->mem )
+      timer->mem->peak = mem_peak;
+
+    return done;
+  }
+
+
+  static void
+  benchmark( FT_Face   face,
+             btest_t*  test,
+             int       max_iter,
+             double    max_time )
+  {
+    static bhisto_t     histo;
+    static bsamples_t   samples;
+    static bmem_t       mem;
+    static bsamples_t*  rep_samples;
+    static bio_t        io;
+
+    btimer_t   timer;
+    bresult_t  result;
+    double     rep_us[MAX_REPEATS];
+    int        kept[MAX_REPEATS];
+    int        min_repeats, n, i;
+    double     start, time = 0;
+    int        done = 0;
+
+
+    if ( current_font )
+    {
+      benchmark_font( face, test, max_iter, max_time );
+
+      return;
+    }
+
+#ifdef FTBENCH_THREADS
+    if ( num_threads > 1 )
+    {
+      benchmark_threads( test, max_iter, max_time );
+
+      if ( share_caches && test->cache_first && cache_man )
+        benchmark_shared( face, test, max_iter, max_time );
+
+      return;
+    }
+#endif
+
+    if ( test->cache_first && !cache_man )
+    {
+      report_skip( test->title, "no cache manager" );
+
+      return;
+    }
+
+    /* each repetition keeps its own samples for outlier rejection */
+    min_repeats = target_ci > 0 && num_repeats < 3 ? 3 : num_repeats;
+    if ( min_repeats > 1 && !rep_samples )
+    {
+      rep_samples = (bsamples_t*)malloc( MAX_REPEATS *
+                                         sizeof ( bsamples_t ) );
+      if ( !rep_samples )
+      {
+        report_skip( test->title, "couldn't allocate samples" );
+
+        return;
+      }
+    }
+
+    bench_warmup( face, test );
+
+    report_start( test->title );
+
+    /* only tests that open faces use the instrumented streams */
+    memset( &io, 0, sizeof ( io ) );
+    if ( use_streams )
+    {
+      io_counts = &io;
+      io_phase  = test->title;
+    }
+
+    timer.histo = &histo;
+    timer.perf  = use_perf_events ? &main_perf : NULL;
+    timer.mem   = count_allocs ? &mem : NULL;
+    bench_reset( &timer );
+
+    memset( &result, 0, sizeof ( result ) );
+
+    /* Repeat the test at least `min_repeats' times; in adaptive mode */
+    /* (option `-E'), continue until the confidence interval of the   */
+    /* kept repetitions is narrow enough or time is up.               */
+    start = timer_clock();
+    for ( n = 0; n < MAX_REPEATS; )
+    {
+      double  t = TIMER_GET( &timer );
+      int     d;
+
+
+      d = bench_loop( face,
+                      test,
+                      &timer,
+                      min_repeats > 1 ? &rep_samples[n] : &samples,
+                      max_iter,
+                      max_time );
+      if ( !d )
+        break;
+
+      rep_us[n++]  = ( TIMER_GET( &timer ) - t ) / d;
+      result.done += d;
+
+      if ( n < min_repeats )
+        continue;
+      if ( target_ci <= 0 )
+        break;
+
+      bench_reject_outliers( rep_us, n, kept );
+      result.ci = bench_confidence_interval( rep_us, kept, n );
+      if ( ( result.ci >= 0 && result.ci <= target_ci )  ||
+           timer_clock() - start > 1E6 * max_repeat_time )
+        break;
+    }
+
+    if ( min_repeats > 1 && n )
+    {
+      result.repeats  = n;
+      result.rejected = n - bench_reject_outliers( rep_us, n, kept );
+      result.ci       = bench_confidence_interval( rep_us, kept, n );
+
+      bench_samples_reset( &samples );
+      for ( i = 0; i < n; i++ )
+      {
+        if ( !kept[i] )
+          continue;
+
+        time += rep_us[i];
+        done++;
+
+        /* feed the samples of all kept repetitions into one store */
+        bench_samples_merge( &samples, &rep_samples[i] );
+      }
+      result.us_per_op = time / done;
+    }
+
+    io_counts = NULL;
+    io_phase  = NULL;
+
+    result.title   = test->title;
+    result.time    = TIMER_GET( &timer );
+    result.io      = io.faces > 0 ? &io : NULL;
+    result.histo   = &histo;
+    result.samples = &samples;
+    result.perf    = timer.perf;
+    result.mem     = timer.mem;
+    result.lookups = timer.lookups;
+    result.misses  = timer.misses;
+
+    result.lookup_unit = test->lookup_unit;
+
+    report_result( &result );
+  }
+
+
+  /*
+   * Various tests
+   */
+
+  static int
+  test_load( btimer_t*  timer,
+             FT_Face    face,
+             void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      TIMER_START( timer );
+      if ( !FT_Load_Glyph( face, i, load_flags ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_load_advances( btimer_t*  timer,
+                      FT_Face    face,
+                      void*      user_data )
+  {
+    int        done = 0;
+    FT_Fixed*  advances;
+    FT_ULong   flags = *((FT_ULong*)user_data);
+    FT_UInt    start, count;
+
+
+    if ( incr_index > 0 )
+    {
+      start = first_index;
+      count = last_index - first_index + 1;
+    }
+    else
+    {
+      start = last_index;
+      count = first_index - last_index + 1;
+    }
+
+    advances = (FT_Fixed *)calloc( sizeof ( FT_Fixed ), (size_t)count );
+
+    TIMER_START( timer );
+
+    FT_Get_Advances( face, start, count, (FT_Int32)flags, advances );
+    done += (int)count;
+
+    TIMER_STOP_N( timer, done );
+
+    free( advances );
+
+    return done;
+  }
+
+
+  static int
+  test_render( btimer_t*  timer,
+               FT_Face    face,
+               void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      if ( !FT_Render_Glyph( face->glyph, render_mode ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_embolden( btimer_t*  timer,
+                 FT_Face    face,
+                 void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      FT_GlyphSlot_Embolden( face->glyph );
+      done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_stroke( btimer_t*  timer,
+               FT_Face    face,
+               void*      user_data )
+  {
+    FT_Glyph      glyph;
+    FT_Stroker    stroker;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FT_Stroker_New( lib, &stroker );
+    FT_Stroker_Set( stroker, face->size->metrics.y_ppem,
+                    FT_STROKER_LINECAP_ROUND,
+                    FT_STROKER_LINEJOIN_ROUND,
+                    0 );
+
+    FOREACH( i )
+    {
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      if ( FT_Get_Glyph( face->glyph, &glyph ) )
+        continue;
+
+      TIMER_START( timer );
+      FT_Glyph_Stroke( &glyph, stroker, 1 );
+      TIMER_STOP( timer );
+
+      FT_Done_Glyph( glyph );
+      done++;
+    }
+
+    FT_Stroker_Done( stroker );
+
+    return done;
+  }
+
+
+  static int
+  test_get_glyph( btimer_t*  timer,
+                  FT_Face    face,
+                  void*      user_data )
+  {
+    FT_Glyph      glyph;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      if ( !FT_Get_Glyph( face->glyph, &glyph ) )
+      {
+        FT_Done_Glyph( glyph );
+        done++;
+      }
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_get_cbox( btimer_t*  timer,
+                 FT_Face    face,
+                 void*      user_data )
+  {
+    FT_Glyph      glyph;
+    FT_BBox       bbox;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      if ( FT_Get_Glyph( face->glyph, &glyph ) )
+        continue;
+
+      TIMER_START( timer );
+      FT_Glyph_Get_CBox( glyph, FT_GLYPH_BBOX_PIXELS, &bbox );
+      TIMER_STOP( timer );
+
+      FT_Done_Glyph( glyph );
+      done++;
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_get_bbox( btimer_t*  timer,
+                 FT_Face    face,
+                 void*      user_data )
+  {
+    FT_BBox       bbox;
+    unsigned int  i;
+    int           done  = 0;
+    FT_Matrix     rot30 = { 0xDDB4, -0x8000, 0x8000, 0xDDB4 };
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      FT_Outline*  outline;
+
+
+      if ( FT_Load_Glyph( face, i, load_flags ) )
+        continue;
+
+      outline = &face->glyph->outline;
+
+      /* rotate outline by 30 degrees */
+      FT_Outline_Transform( outline, &rot30 );
+
+      TIMER_START( timer );
+      FT_Outline_Get_BBox( outline, &bbox );
+      TIMER_STOP( timer );
+
+      done++;
+    }
+
+    return done;
+  }
+
+
+  /*
+   * Batched variants of the last two tests: the glyphs are prepared in
+   * groups of `BATCH_SIZE', then the whole group is timed at once, so
+   * that the cost of reading the clock is negligible.
+   */
+
+#define BATCH_SIZE  64
+
+  /* the modes of `load_glyph_batch' */
+#define BATCH_ALL       0
+#define BATCH_OUTLINES  1  /* outline glyphs only */
+#define BATCH_ROTATED   2  /* outline glyphs only, rotated by 30 degrees */
+
+  /* load the next `BATCH_SIZE' glyphs (starting with `*i') as glyph */
+  /* objects according to `mode'; return their number                */
+  static int
+  load_glyph_batch( FT_Face        face,
+                    unsigned int*  i,
+                    int*           more,
+                    FT_Glyph*      glyphs,
+                    int            mode )
+  {
+    FT_Matrix  rot30 = { 0xDDB4, -0x8000, 0x8000, 0xDDB4 };
+    int        n     = 0;
+
+
+    for ( ; *more && n < BATCH_SIZE; *i += incr_index )
+    {
+      if ( *i == last_index )
+        *more = 0;
+
+      if ( FT_Load_Glyph( face, *i, load_flags ) )
+        continue;
+
+      if ( mode != BATCH_ALL                                  &&
+           face->glyph->format != FT_GLYPH_FORMAT_OUTLINE     )
+        continue;
+
+      if ( FT_Get_Glyph( face->glyph, &glyphs[n] ) )
+        continue;
+
+      if ( mode == BATCH_ROTATED )
+        FT_Glyph_Transform( glyphs[n], &rot30, NULL );
+
+      n++;
+    }
+
+    return n;
+  }
+
+
+  static int
+  test_get_cbox_batched( btimer_t*  timer,
+                         FT_Face    face,
+                         void*      user_data )
+  {
+    FT_Glyph      glyphs[BATCH_SIZE];
+    FT_BBox       bbox;
+    unsigned int  i    = first_index;
+    int           more = 1;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    while ( more )
+    {
+      int  n = load_glyph_batch( face, &i, &more, glyphs, BATCH_ALL );
+      int  j;
+
+
+      TIMER_START( timer );
+      for ( j = 0; j < n; j++ )
+        FT_Glyph_Get_CBox( glyphs[j], FT_GLYPH_BBOX_PIXELS, &bbox );
+      TIMER_STOP_N( timer, n );
+
+      for ( j = 0; j < n; j++ )
+        FT_Done_Glyph( glyphs[j] );
+      done += n;
+    }
+
+    return done;
+  }
+
+
+  static int
+  test_get_bbox_batched( btimer_t*  timer,
+                         FT_Face    face,
+                         void*      user_data )
+  {
+    FT_Glyph      glyphs[BATCH_SIZE];
+    FT_BBox       bbox;
+    unsigned int  i    = first_index;
+    int           more = 1;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    while ( more )
+    {
+      int  n = load_glyph_batch( face, &i, &more, glyphs,
+                                BATCH_ROTATED );
+      int  j;
+
+
+      TIMER_START( timer );
+      for ( j = 0; j < n; j++ )
+        FT_Outline_Get_BBox( &( (FT_OutlineGlyph)glyphs[j] )->outline,
+                             &bbox );
+      TIMER_STOP_N( timer, n );
+
+      for ( j = 0; j < n; j++ )
+        FT_Done_Glyph( glyphs[j] );
+      done += n;
+    }
+
+    return done;
+  }
+
+
+  /*
+   * Outline processing (test `q'): the glyphs are loaded in batches
+   * without timing, then a single `FT_Outline_XXX' function is timed for
+   * the whole batch.
+   */
+
+  enum {
+    OUTLINE_DECOMPOSE,
+    OUTLINE_TRANSFORM,
+    OUTLINE_TRANSLATE,
+    OUTLINE_ORIENTATION,
+    OUTLINE_EMBOLDEN
+  };
+
+  typedef struct  boutline_t_ {
+    int     op;
+    FT_Pos  strength;  /* for `OUTLINE_EMBOLDEN', in 26.6 pixels */
+
+  } boutline_t;
+
+  /* the strengths of `FT_Outline_EmboldenXY', in pixels */
+  static const double  embolden_strengths[] = { 0.25, 1, 4 };
+
+#define N_EMBOLDEN_STRENGTHS                     \
+          (int)( sizeof ( embolden_strengths ) / \
+                 sizeof ( embolden_strengths[0] ) )
+
+#define OUTLINE( glyph )  ( &( (FT_OutlineGlyph)(glyph) )->outline )
+
+
+  static int
+  outline_move_to( const FT_Vector*  to,
+                   void*             user )
+  {
+    FT_UNUSED( to );
+    FT_UNUSED( user );
+
+    return 0;
+  }
+
+
+  static int
+  outline_conic_to( const FT_Vector*  control,
+                    const FT_Vector*  to,
+                    void*             user )
+  {
+    FT_UNUSED( control );
+    FT_UNUSED( to );
+    FT_UNUSED( user );
+
+    return 0;
+  }
+
+
+  static int
+  outline_cubic_to( const FT_Vector*  control1,
+                    const FT_Vector*  control2,
+                    const FT_Vector*  to,
+                    void*             user )
+  {
+    FT_UNUSED( control1 );
+    FT_UNUSED( control2 );
+    FT_UNUSED( to );
+    FT_UNUSED( user );
+
+    return 0;
+  }
+
+
+  static const FT_Outline_Funcs  outline_funcs =
+  {
+    outline_move_to,
+    outline_move_to,   /* line_to */
+    outline_conic_to,
+    outline_cubic_to,
+    0,
+    0
+  };
+
+
+  static int
+  test_outline( btimer_t*  timer,
+                FT_Face    face,
+                void*      user_data )
+  {
+    boutline_t*   op    = (boutline_t*)user_data;
+    FT_Matrix     rot30 = { 0xDDB4, -0x8000, 0x8000, 0xDDB4 };
+    FT_Glyph      glyphs[BATCH_SIZE];
+    unsigned int  i     = first_index;
+    int           more  = 1;
+    int           done  = 0;
+
+
+    while ( more )
+    {
+      int  n = load_glyph_batch( face, &i, &more, glyphs,
+                                BATCH_OUTLINES );
+      int  j;
+
+
+      TIMER_START( timer );
+
+      switch ( op->op )
+      {
+      case OUTLINE_DECOMPOSE:
+        for ( j = 0; j < n; j++ )
+          FT_Outline_Decompose( OUTLINE( glyphs[j] ), &outline_funcs, NULL );
+        break;
+
+      case OUTLINE_TRANSFORM:
+        for ( j = 0; j < n; j++ )
+          FT_Outline_Transform( OUTLINE( glyphs[j] ), &rot30 );
+        break;
+
+      case OUTLINE_TRANSLATE:
+        for ( j = 0; j < n; j++ )
+          FT_Outline_Translate( OUTLINE( glyphs[j] ), 37, -21 );
+        break;
+
+      case OUTLINE_ORIENTATION:
+        for ( j = 0; j < n; j++ )
+          FT_Outline_Get_Orientation( OUTLINE( glyphs[j] ) );
+        break;
+
+      default:
+        for ( j = 0; j < n; j++ )
+          FT_Outline_EmboldenXY( OUTLINE( glyphs[j] ),
+                                 op->strength,
+                                 op->strength );
+      }
+
+      TIMER_STOP_N( timer, n );
+
+      for ( j = 0; j < n; j++ )
+        FT_Done_Glyph( glyphs[j] );
+      done += n;
+    }
+
+    return done;
+  }
+
+
+  /* render outlines into a buffer allocated (and cleared) beforehand */
+  static int
+  test_outline_get_bitmap( btimer_t*  timer,
+                           FT_Face    face,
+                           void*      user_data )
+  {
+    FT_Glyph        glyphs[BATCH_SIZE];
+    FT_Bitmap       bitmaps[BATCH_SIZE];
+    size_t          offsets[BATCH_SIZE];
+    unsigned char*  buffer      = NULL;
+    size_t          buffer_size = 0;
+    unsigned int    i           = first_index;
+    int             more        = 1;
+    int             done        = 0;
+
+    FT_UNUSED( user_data );
+
+
+    while ( more )
+    {
+      int     n = load_glyph_batch( face, &i, &more, glyphs,
+                                    BATCH_OUTLINES );
+      int     j, m = 0;
+      size_t  size = 0;
+
+
+      /* move the outlines to the origin and lay out their bitmaps */
+      for ( j = 0; j < n; j++ )
+      {
+        FT_Outline*  outline = OUTLINE( glyphs[j] );
+        FT_BBox      cbox;
+
+
+        FT_Outline_Get_CBox( outline, &cbox );
+        cbox.xMin = cbox.xMin & -64;
+        cbox.yMin = cbox.yMin & -64;
+        cbox.xMax = ( cbox.xMax + 63 ) & -64;
+        cbox.yMax = ( cbox.yMax + 63 ) & -64;
+
+        if ( cbox.xMax <= cbox.xMin || cbox.yMax <= cbox.yMin )
+          continue;
+
+        FT_Outline_Translate( outline, -cbox.xMin, -cbox.yMin );
+
+        FT_Bitmap_Init( &bitmaps[m] );
+        bitmaps[m].width      = (unsigned int)( cbox.xMax - cbox.xMin ) >> 6;
+        bitmaps[m].rows       = (unsigned int)( cbox.yMax - cbox.yMin ) >> 6;
+        bitmaps[m].pitch      = (int)bitmaps[m].width;
+        bitmaps[m].num_grays  = 256;
+        bitmaps[m].pixel_mode = FT_PIXEL_MODE_GRAY;
+
+        offsets[m] = size;
+        size      += (size_t)bitmaps[m].width * bitmaps[m].rows;
+
+        if ( m != j )
+        {
+          FT_Glyph  tmp = glyphs[m];
+
+
+          glyphs[m] = glyphs[j];
+          glyphs[j] = tmp;
+        }
+        m++;
+      }
+
+      if ( size > buffer_size )
+      {
+        unsigned char*  p = (unsigned char*)realloc( buffer, size );
+
+
+        if ( !p )
+          m = 0;
+        else
+        {
+          buffer      = p;
+          buffer_size = size;
+        }
+      }
+
+      if ( m )
+        memset( buffer, 0, size );
+      for ( j = 0; j < m; j++ )
+        bitmaps[j].buffer = buffer + offsets[j];
+
+      TIMER_START( timer );
+      for ( j = 0; j < m; j++ )
+        FT_Outline_Get_Bitmap( lib, OUTLINE( glyphs[j] ), &bitmaps[j] );
+      TIMER_STOP_N( timer, m );
+
+      for ( j = 0; j < n; j++ )
+        FT_Done_Glyph( glyphs[j] );
+      done += m;
+    }
+
+    free( buffer );
+
+    return done;
+  }
+
+
+  static int
+  test_get_char_index( btimer_t*  timer,
+                       FT_Face    face,
+                       void*      user_data )
+  {
+    bcharset_t*  charset = (bcharset_t*)user_data;
+    int          i, done = 0;
+
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < charset->size; i++ )
+    {
+      if ( FT_Get_Char_Index(face, charset->code[i]) )
+        done++;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+#ifdef FTBENCH_THREADS
+
+  /*
+   * With option `-G', the threads of the cached tests share the cache
+   * manager and the caches of the main thread (and thus its face and
+   * library); as required by FreeType, every use of them is guarded by
+   * a mutex.  The times of waiting for the mutex and of holding it are
+   * wall-clock times.
+   */
+
+  typedef struct  bshared_t_ {
+    pthread_mutex_t   mutex;
+    FT_Face           face;
+    FTC_Manager       manager;
+    FTC_CMapCache     cmap_cache;
+    FTC_ImageCache    image_cache;
+    FTC_SBitCache     sbit_cache;
+    FTC_ImageTypeRec  font_type;
+    unsigned int      first_index;
+    unsigned int      last_index;
+    int               incr_index;
+
+  } bshared_t;
+
+
+  /* non-NULL while the threads share the caches */
+  static bshared_t*  shared_cache;
+
+
+  static void
+  cache_lock( btimer_t*  timer )
+  {
+    double  t0 = bench_wall_time();
+
+
+    pthread_mutex_lock( &shared_cache->mutex );
+
+    timer->lock_t0    = bench_wall_time();
+    timer->lock_wait += timer->lock_t0 - t0;
+    timer->locks++;
+  }
+
+
+  static void
+  cache_unlock( btimer_t*  timer )
+  {
+    timer->lock_hold += bench_wall_time() - timer->lock_t0;
+
+    pthread_mutex_unlock( &shared_cache->mutex );
+  }
+
+
+#define CACHE_LOCK( timer )                 \
+          do                                \
+          {                                 \
+            if ( shared_cache )             \
+              cache_lock( timer );          \
+          } while ( 0 )
+
+#define CACHE_UNLOCK( timer )               \
+          do                                \
+          {                                 \
+            if ( shared_cache )             \
+              cache_unlock( timer );        \
+          } while ( 0 )
+
+#else /* !FTBENCH_THREADS */
+
+#define CACHE_LOCK( timer )    /* empty */
+#define CACHE_UNLOCK( timer )  /* empty */
+
+#endif /* !FTBENCH_THREADS */
+
+
+  static int
+  test_cmap_cache( btimer_t*  timer,
+                   FT_Face    face,
+                   void*      user_data )
+  {
+    bcharset_t*  charset = (bcharset_t*)user_data;
+    int          i, done = 0;
+
+    FT_UNUSED( face );
+
+
+    if ( !cmap_cache )
+    {
+      if ( FTC_CMapCache_New( cache_man, &cmap_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < charset->size; i++ )
+    {
+      CACHE_LOCK( timer );
+      if ( FTC_CMapCache_Lookup( cmap_cache,
+                                 font_type.face_id,
+                                 0,
+                                 charset->code[i] ) )
+        done++;
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_image_cache( btimer_t*  timer,
+                    FT_Face    face,
+                    void*      user_data )
+  {
+    FT_Glyph      glyph;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( face );
+    FT_UNUSED( user_data );
+
+
+    if ( !image_cache )
+    {
+      if ( FTC_ImageCache_New( cache_man, &image_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    FOREACH( i )
+    {
+      CACHE_LOCK( timer );
+      if ( !FTC_ImageCache_Lookup( image_cache,
+                                   &font_type,
+                                   i,
+                                   &glyph,
+                                   NULL ) )
+        done++;
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_sbit_cache( btimer_t*  timer,
+                   FT_Face    face,
+                   void*      user_data )
+  {
+    FTC_SBit      glyph;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( face );
+    FT_UNUSED( user_data );
+
+
+    if ( !sbit_cache )
+    {
+      if ( FTC_SBitCache_New( cache_man, &sbit_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    FOREACH( i )
+    {
+      CACHE_LOCK( timer );
+      if ( !FTC_SBitCache_Lookup( sbit_cache,
+                                  &font_type,
+                                  i,
+                                  &glyph,
+                                  NULL ) )
+        done++;
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_cmap_iter( btimer_t*  timer,
+                  FT_Face    face,
+                  void*      user_data )
+  {
+    FT_UInt   idx;
+    FT_ULong  charcode;
+
+    FT_UNUSED( user_data );
+
+
+    TIMER_START( timer );
+
+    charcode = FT_Get_First_Char( face, &idx );
+    while ( idx != 0 )
+      charcode = FT_Get_Next_Char( face, charcode, &idx );
+
+    TIMER_STOP( timer );
+
+    return 1;
+  }
+
+
+  static int
+  test_new_face( btimer_t*  timer,
+                 FT_Face    face,
+                 void*      user_data )
+  {
+    FT_Face   bench_face;
+    FT_Byte*  data;
+    size_t    size;
+
+    FT_UNUSED( face );
+    FT_UNUSED( user_data );
+
+
+    if ( cold_cache )
+      drop_page_cache();
+
+    TIMER_START( timer );
+
+    if ( !get_new_face( &bench_face, &data, &size ) )
+      FT_Done_Face( bench_face );
+
+    TIMER_STOP( timer );
+
+    unload_font_data( preload, data, size );
+
+    return 1;
+  }
+
+
+  static int
+  test_new_face_and_load_glyph( btimer_t*  timer,
+                                FT_Face    face,
+                                void*      user_data )
+  {
+    FT_Face   bench_face;
+    FT_Byte*  data;
+    size_t    size;
+
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( face );
+    FT_UNUSED( user_data );
+
+
+    if ( cold_cache )
+      drop_page_cache();
+
+    TIMER_START( timer );
+
+    if ( !get_new_face( &bench_face, &data, &size ) )
+    {
+      FOREACH( i )
+      {
+        if ( !FT_Load_Glyph( bench_face, i, load_flags ) )
+          done++;
+      }
+
+      FT_Done_Face( bench_face );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    unload_font_data( preload, data, size );
+
+    return done;
+  }
+
+
+  /*
+   * Time to first glyph (test `s'): every call goes the whole way from
+   * creating a library to rendering a glyph, and times one phase of it.
+   * FreeType runs the TrueType `fpgm' and `prep' programs and computes
+   * the auto-hinter's global metrics lazily, so they are part of the
+   * first `FT_Load_Glyph' call; `FIRST_LOAD_AGAIN' loads the same glyph
+   * a second time to tell them apart.
+   */
+
+  enum {
+    FIRST_INIT,        /* FT_Init_FreeType and library properties */
+    FIRST_NEW_FACE,
+    FIRST_SET_SIZE,
+    FIRST_LOAD,
+    FIRST_RENDER,
+    FIRST_TOTAL,       /* from FIRST_INIT to FIRST_RENDER */
+    FIRST_LOAD_AGAIN
+  };
+
+
+  typedef struct  bfirst_t_ {
+    int       phase;  /* FIRST_XXX */
+    FT_UInt   gindex;
+    FT_Int32  flags;
+
+  } bfirst_t;
+
+
+#define FIRST_START( first, timer, p )            \
+          do                                      \
+          {                                       \
+            if ( ( first )->phase == (p) )        \
+              TIMER_START( timer );               \
+          } while ( 0 )
+
+#define FIRST_STOP( first, timer, p, error )      \
+          do                                      \
+          {                                       \
+            if ( ( first )->phase == (p) )        \
+            {                                     \
+              TIMER_STOP( timer );                \
+              if ( !(error) )                     \
+                done = 1;                         \
+            }                                     \
+          } while ( 0 )
+
+
+  static int
+  test_first_glyph( btimer_t*  timer,
+                    FT_Face    face,
+                    void*      user_data )
+  {
+    bfirst_t*   first = (bfirst_t*)user_data;
+    FT_Library  saved = lib;
+    FT_Library  library;
+    FT_Face     bench_face = NULL;
+    FT_Byte*    data       = NULL;
+    size_t      size       = 0;
+    FT_Error    error;
+    int         done = 0;
+
+    FT_UNUSED( face );
+
+
+    if ( cold_cache )
+      drop_page_cache();
+
+    FIRST_START( first, timer, FIRST_TOTAL );
+
+    FIRST_START( first, timer, FIRST_INIT );
+    error = new_library( &library );
+    if ( !error )
+    {
+      lib = library;
+      set_library_properties( lib );
+    }
+    FIRST_STOP( first, timer, FIRST_INIT, error );
+    if ( error )
+      goto Exit;
+
+    /* `get_new_face' opens the face with `lib' */
+    FIRST_START( first, timer, FIRST_NEW_FACE );
+    error = get_new_face( &bench_face, &data, &size );
+    FIRST_STOP( first, timer, FIRST_NEW_FACE, error );
+    if ( error )
+    {
+      bench_face = NULL;
+      goto Exit;
+    }
+
+    FIRST_START( first, timer, FIRST_SET_SIZE );
+    error = set_face_size( bench_face );
+    FIRST_STOP( first, timer, FIRST_SET_SIZE, error );
+    if ( error )
+      goto Exit;
+
+    FIRST_START( first, timer, FIRST_LOAD );
+    error = FT_Load_Glyph( bench_face, first->gindex, first->flags );
+    FIRST_STOP( first, timer, FIRST_LOAD, error );
+    if ( error )
+      goto Exit;
+
+    FIRST_START( first, timer, FIRST_RENDER );
+    error = FT_Render_Glyph( bench_face->glyph, render_mode );
+    FIRST_STOP( first, timer, FIRST_RENDER, error );
+    if ( error )
+      goto Exit;
+
+    FIRST_STOP( first, timer, FIRST_TOTAL, error );
+
+    FIRST_START( first, timer, FIRST_LOAD_AGAIN );
+    error = FT_Load_Glyph( bench_face, first->gindex, first->flags );
+    FIRST_STOP( first, timer, FIRST_LOAD_AGAIN, error );
+
+  Exit:
+    /* close the timed section of an incomplete path */
+    if ( error && first->phase == FIRST_TOTAL )
+      TIMER_STOP( timer );
+
+    if ( bench_face )
+      FT_Done_Face( bench_face );
+    unload_font_data( preload, data, size );
+
+    if ( lib != saved )
+    {
+      done_library( lib );
+      lib = saved;
+    }
+
+    return done;
+  }
+
+
+  /*
+   * Size churn (test `t'): switch between many sizes of the same face,
+   * as a document renderer does, and load a glyph after every switch;
+   * for a new size, the latter runs the TrueType `prep' program.  Only
+   * the size switches get timed.
+   */
+
+#define N_CHURN_SCALES       8
+#define N_CHURN_RESOLUTIONS  3
+#define N_CHURN_SIZES        ( N_CHURN_SCALES * N_CHURN_RESOLUTIONS )
+
+  static const double   churn_scales[N_CHURN_SCALES] =
+  {
+    0.5, 0.75, 1, 1.25, 1.5, 2, 2.5, 3
+  };
+  static const FT_UInt  churn_resolutions[N_CHURN_RESOLUTIONS] =
+  {
+    72, 96, 144
+  };
+
+
+  typedef struct  bchurn_t_ {
+    FTC_ScalerRec  scalers[N_CHURN_SIZES];  /* in points at a resolution */
+    FT_UInt        gindex;
+
+  } bchurn_t;
+
+
+  static void
+  churn_init( bchurn_t*  churn,
+              FT_Face    face )
+  {
+    int  i;
+
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      FTC_Scaler  scaler = &churn->scalers[i];
+      FT_UInt     res    = churn_resolutions[i % N_CHURN_RESOLUTIONS];
+
+
+      scaler->face_id = font_type.face_id;
+      scaler->width   = (FT_UInt)( face_size * 64 *
+                                   churn_scales[i / N_CHURN_RESOLUTIONS] );
+      scaler->height  = scaler->width;
+      scaler->pixel   = 0;
+      scaler->x_res   = res;
+      scaler->y_res   = res;
+    }
+
+    churn->gindex = FT_Get_Char_Index( face, 'A' );
+    if ( !churn->gindex )
+      churn->gindex = first_index;
+  }
+
+
+  static FT_Error
+  churn_set_size( FT_Face     face,
+                  FTC_Scaler  scaler )
+  {
+    return FT_Set_Char_Size( face,
+                             (FT_F26Dot6)scaler->width,
+                             (FT_F26Dot6)scaler->height,
+                             scaler->x_res,
+                             scaler->y_res );
+  }
+
+
+  /* Two cache managers can't share the size objects of a face, so the */
+  /* additional manager of test `t' gets a face of its own.            */
+  static FT_Error
+  churn_face_requester( FTC_FaceID  face_id,
+                        FT_Library  library,
+                        FT_Pointer  request_data,
+                        FT_Face*    aface )
+  {
+    FT_UNUSED( face_id );
+    FT_UNUSED( library );
+    FT_UNUSED( request_data );
+
+    return get_face( aface );
+  }
+
+
+  /* create, set up, and use a new size object for every size */
+  static int
+  test_new_size( btimer_t*  timer,
+                 FT_Face    face,
+                 void*      user_data )
+  {
+    bchurn_t*  churn = (bchurn_t*)user_data;
+    FT_Size    saved = face->size;
+    FT_Size    sizes[N_CHURN_SIZES];
+    int        i, done = 0;
+
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      FT_Error  error;
+
+
+      TIMER_START( timer );
+      error = FT_New_Size( face, &sizes[i] );
+      if ( !error )
+      {
+        FT_Activate_Size( sizes[i] );
+        error = churn_set_size( face, &churn->scalers[i] );
+      }
+      else
+        sizes[i] = NULL;
+      TIMER_STOP( timer );
+
+      if ( !error && !FT_Load_Glyph( face, churn->gindex, load_flags ) )
+        done++;
+    }
+
+    FT_Activate_Size( saved );
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+      if ( sizes[i] )
+        FT_Done_Size( sizes[i] );
+
+    return done;
+  }
+
+
+  /* switch between size objects that have been set up before */
+  static int
+  test_activate_size( btimer_t*  timer,
+                      FT_Face    face,
+                      void*      user_data )
+  {
+    bchurn_t*  churn = (bchurn_t*)user_data;
+    FT_Size    saved = face->size;
+    FT_Size    sizes[N_CHURN_SIZES];
+    FT_Error   error;
+    int        i, done = 0;
+
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      if ( FT_New_Size( face, &sizes[i] ) )
+      {
+        sizes[i] = NULL;
+        continue;
+      }
+
+      FT_Activate_Size( sizes[i] );
+      churn_set_size( face, &churn->scalers[i] );
+      FT_Load_Glyph( face, churn->gindex, load_flags );
+    }
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      if ( !sizes[i] )
+        continue;
+
+      TIMER_START( timer );
+      error = FT_Activate_Size( sizes[i] );
+      TIMER_STOP( timer );
+
+      if ( !error && !FT_Load_Glyph( face, churn->gindex, load_flags ) )
+        done++;
+    }
+
+    FT_Activate_Size( saved );
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+      if ( sizes[i] )
+        FT_Done_Size( sizes[i] );
+
+    return done;
+  }
+
+
+  /* change the size of a single size object */
+  static int
+  test_set_char_size( btimer_t*  timer,
+                      FT_Face    face,
+                      void*      user_data )
+  {
+    bchurn_t*  churn = (bchurn_t*)user_data;
+    FT_Size    saved = face->size;
+    FT_Size    size;
+    int        i, done = 0;
+
+
+    /* the active size might belong to the cache manager */
+    if ( FT_New_Size( face, &size ) )
+      return 0;
+    FT_Activate_Size( size );
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      FT_Error  error;
+
+
+      TIMER_START( timer );
+      error = churn_set_size( face, &churn->scalers[i] );
+      TIMER_STOP( timer );
+
+      if ( !error && !FT_Load_Glyph( face, churn->gindex, load_flags ) )
+        done++;
+    }
+
+    FT_Activate_Size( saved );
+    FT_Done_Size( size );
+
+    return done;
+  }
+
+
+  /*
+   * Look up the sizes in the cache manager.  New size objects have a
+   * zero `generic.data' field, which we set for all sizes we get, so that
+   * a cache miss can be detected.
+   */
+  static int
+  test_lookup_size( btimer_t*  timer,
+                    FT_Face    face,
+                    void*      user_data )
+  {
+    bchurn_t*      churn = (bchurn_t*)user_data;
+    FTC_ScalerRec  scaler;
+    FT_Size        size;
+    int            i, done = 0;
+
+    FT_UNUSED( face );
+
+
+    for ( i = 0; i < N_CHURN_SIZES; i++ )
+    {
+      CACHE_LOCK( timer );
+
+      TIMER_START( timer );
+      if ( FTC_Manager_LookupSize( cache_man, &churn->scalers[i], &size ) )
+        size = NULL;
+      TIMER_STOP( timer );
+
+      if ( size && !FT_Load_Glyph( size->face, churn->gindex, load_flags ) )
+        done++;
+
+      if ( size )
+      {
+        timer->lookups++;
+        if ( !size->generic.data )
+        {
+          timer->misses++;
+          size->generic.data = (void*)churn;
+        }
+      }
+
+      CACHE_UNLOCK( timer );
+    }
+
+    /* the previously active size might have been evicted from the */
+    /* cache, so activate the one of the cached tests              */
+    scaler.face_id = font_type.face_id;
+    scaler.width   = font_type.width;
+    scaler.height  = font_type.height;
+    scaler.pixel   = 1;
+    scaler.x_res   = 0;
+    scaler.y_res   = 0;
+    CACHE_LOCK( timer );
+    FTC_Manager_LookupSize( cache_man, &scaler, &size );
+    CACHE_UNLOCK( timer );
+
+    return done;
+  }
+
+
+  /*
+   * The glyph caches call `FT_Load_Glyph' on our face for every glyph
+   * they don't hold yet, so a cache miss can be detected by invalidating
+   * the glyph slot's format before the lookup.
+   */
+#define CACHE_LOOKUP_START( face )                                 \
+          ( face )->glyph->format = FT_GLYPH_FORMAT_NONE
+
+#define CACHE_LOOKUP_STOP( timer, face )                           \
+          do                                                       \
+          {                                                        \
+            ( timer )->lookups++;                                  \
+            if ( ( face )->glyph->format != FT_GLYPH_FORMAT_NONE ) \
+              ( timer )->misses++;                                 \
+          } while ( 0 )
+
+
+  static int
+  test_text_sbit_cache( btimer_t*  timer,
+                        FT_Face    face,
+                        void*      user_data )
+  {
+    bcharset_t*  text = (bcharset_t*)user_data;
+    FTC_SBit     sbit;
+    FT_UInt      gindex;
+    int          i, done = 0;
+
+
+    if ( !cmap_cache )
+    {
+      if ( FTC_CMapCache_New( cache_man, &cmap_cache ) )
+        return 0;
+    }
+    if ( !sbit_cache )
+    {
+      if ( FTC_SBitCache_New( cache_man, &sbit_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < text->size; i++ )
+    {
+      CACHE_LOCK( timer );
+
+      /* a negative charmap index selects the face's active charmap */
+      gindex = FTC_CMapCache_Lookup( cmap_cache,
+                                     font_type.face_id,
+                                     -1,
+                                     text->code[i] );
+
+      CACHE_LOOKUP_START( face );
+      if ( !FTC_SBitCache_Lookup( sbit_cache,
+                                  &font_type,
+                                  gindex,
+                                  &sbit,
+                                  NULL ) )
+        done++;
+      CACHE_LOOKUP_STOP( timer, face );
+
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_text_image_cache( btimer_t*  timer,
+                         FT_Face    face,
+                         void*      user_data )
+  {
+    bcharset_t*  text = (bcharset_t*)user_data;
+    FT_Glyph     glyph, bitmap;
+    FT_UInt      gindex;
+    int          i, done = 0;
+
+
+    if ( !cmap_cache )
+    {
+      if ( FTC_CMapCache_New( cache_man, &cmap_cache ) )
+        return 0;
+    }
+    if ( !image_cache )
+    {
+      if ( FTC_ImageCache_New( cache_man, &image_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < text->size; i++ )
+    {
+      /* rendering uses the library of the cached glyph, too */
+      CACHE_LOCK( timer );
+
+      gindex = FTC_CMapCache_Lookup( cmap_cache,
+                                     font_type.face_id,
+                                     -1,
+                                     text->code[i] );
+
+      CACHE_LOOKUP_START( face );
+      if ( FTC_ImageCache_Lookup( image_cache,
+                                  &font_type,
+                                  gindex,
+                                  &glyph,
+                                  NULL ) )
+      {
+        CACHE_LOOKUP_STOP( timer, face );
+        CACHE_UNLOCK( timer );
+        continue;
+      }
+      CACHE_LOOKUP_STOP( timer, face );
+
+      /* the cached glyph must not be modified; render a copy */
+      bitmap = glyph;
+      if ( !FT_Glyph_To_Bitmap( &bitmap, render_mode, NULL, 0 ) )
+      {
+        if ( bitmap != glyph )
+          FT_Done_Glyph( bitmap );
+        done++;
+      }
+
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+  /* cached lookups of the glyph indices in `user_data' (sweep mode) */
+  static int
+  test_image_cache_list( btimer_t*  timer,
+                         FT_Face    face,
+                         void*      user_data )
+  {
+    bcharset_t*  glyphs = (bcharset_t*)user_data;
+    FT_Glyph     glyph;
+    int          i, done = 0;
+
+
+    if ( !image_cache )
+    {
+      if ( FTC_ImageCache_New( cache_man, &image_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < glyphs->size; i++ )
+    {
+      CACHE_LOCK( timer );
+      CACHE_LOOKUP_START( face );
+      if ( !FTC_ImageCache_Lookup( image_cache,
+                                   &font_type,
+                                   (FT_UInt)glyphs->code[i],
+                                   &glyph,
+                                   NULL ) )
+        done++;
+      CACHE_LOOKUP_STOP( timer, face );
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_sbit_cache_list( btimer_t*  timer,
+                        FT_Face    face,
+                        void*      user_data )
+  {
+    bcharset_t*  glyphs = (bcharset_t*)user_data;
+    FTC_SBit     sbit;
+    int          i, done = 0;
+
+
+    if ( !sbit_cache )
+    {
+      if ( FTC_SBitCache_New( cache_man, &sbit_cache ) )
+        return 0;
+    }
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < glyphs->size; i++ )
+    {
+      CACHE_LOCK( timer );
+      CACHE_LOOKUP_START( face );
+      if ( !FTC_SBitCache_Lookup( sbit_cache,
+                                  &font_type,
+                                  (FT_UInt)glyphs->code[i],
+                                  &sbit,
+                                  NULL ) )
+        done++;
+      CACHE_LOOKUP_STOP( timer, face );
+      CACHE_UNLOCK( timer );
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+  /*
+   * Text layout (test `r'): the steps of `FTDemo_String_Load' in
+   * `ftcommon.c' that don't rasterize, for the glyph indices of a text.
+   */
+
+  /* the metrics of a glyph needed for the layout */
+  typedef struct  blayoutglyph_t_ {
+    int     loaded;
+    FT_Pos  advance;
+    FT_Pos  lsb_delta;
+    FT_Pos  rsb_delta;
+
+  } blayoutglyph_t;
+
+
+  typedef struct  blayout_t_ {
+    bcharset_t*      glyphs;    /* glyph indices of the text */
+    FT_Int32         flags;     /* for `FT_Get_Advances' */
+    FT_Fixed         point_size;
+    FT_Fixed*        advances;  /* one per glyph */
+    blayoutglyph_t*  metrics;   /* ditto, loaded before the timing */
+
+  } blayout_t;
+
+
+  static int
+  test_layout_advances( btimer_t*  timer,
+                        FT_Face    face,
+                        void*      user_data )
+  {
+    blayout_t*  layout = (blayout_t*)user_data;
+    FT_ULong*   code   = layout->glyphs->code;
+    int         size   = layout->glyphs->size;
+    int         i, n, done = 0;
+
+
+    TIMER_START( timer );
+
+    /* one call for every run of consecutive glyph indices */
+    for ( i = 0; i < size; i += n )
+    {
+      for ( n = 1; i + n < size && code[i + n] == code[i + n - 1] + 1; n++ )
+        ;
+
+      if ( !FT_Get_Advances( face,
+                             (FT_UInt)code[i],
+                             (FT_UInt)n,
+                             layout->flags,
+                             layout->advances + i ) )
+        done += n;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  test_layout_kerning( btimer_t*  timer,
+                       FT_Face    face,
+                       void*      user_data )
+  {
+    blayout_t*  layout = (blayout_t*)user_data;
+    FT_ULong*   code   = layout->glyphs->code;
+    FT_Vector   kern;
+    int         i, done = 0;
+
+
+    TIMER_START( timer );
+
+    for ( i = 1; i < layout->glyphs->size; i++ )
+    {
+      if ( !FT_Get_Kerning( face,
+                            (FT_UInt)code[i - 1],
+                            (FT_UInt)code[i],
+                            FT_KERNING_UNFITTED,
+                            &kern ) )
+        done++;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  /* track kerning applies to whole strings; time a batch of calls */
+  static int
+  test_layout_track_kerning( btimer_t*  timer,
+                             FT_Face    face,
+                             void*      user_data )
+  {
+    blayout_t*  layout = (blayout_t*)user_data;
+    FT_Fixed    kerning;
+    int         i, done = 0;
+
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < BATCH_SIZE; i++ )
+    {
+      /* the degrees used by `ftstring' */
+      if ( !FT_Get_Track_Kerning( face,
+                                  layout->point_size,
+                                  -( i % 3 + 1 ),
+                                  &kerning ) )
+        done++;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  /* the complete layout of `FTDemo_String_Load', with kerning and */
+  /* compensation of the lsb and rsb deltas, without glyph images; */
+  /* the glyphs are loaded beforehand (see `load_layout_metrics')  */
+  static int
+  test_layout_string( btimer_t*  timer,
+                      FT_Face    face,
+                      void*      user_data )
+  {
+    blayout_t*       layout  = (blayout_t*)user_data;
+    blayoutglyph_t*  metrics = layout->metrics;
+    FT_ULong*        code    = layout->glyphs->code;
+    int              hinted  = !( load_flags & FT_LOAD_NO_HINTING );
+    FT_Fixed         track_kern     = 0;
+    FT_Pos           pen_x          = 0;
+    FT_Pos           pen_y          = 0;
+    FT_Pos           prev_rsb_delta = 0;
+    FT_UInt          prev           = 0;
+    int              i, done = 0;
+
+
+    TIMER_START( timer );
+
+    /* in points, which are pixels at 72dpi */
+    if ( !FT_Get_Track_Kerning( face, layout->point_size, -1, &track_kern ) )
+      track_kern = (FT_Fixed)( track_kern / 1024.0 );
+
+    for ( i = 0; i < layout->glyphs->size; i++ )
+    {
+      FT_UInt  gindex = (FT_UInt)code[i];
+
+
+      if ( !metrics[i].loaded )
+        continue;
+
+      if ( done && FT_HAS_KERNING( face ) )
+      {
+        FT_Vector  kern;
+
+
+        FT_Get_Kerning( face, prev, gindex, FT_KERNING_UNFITTED, &kern );
+
+        pen_x += kern.x;
+        pen_y += kern.y;
+      }
+
+      /* `KERNING_MODE_SMART' */
+      if ( done )
+      {
+        if ( prev_rsb_delta - metrics[i].lsb_delta > 32 )
+          pen_x -= 64;
+        else if ( prev_rsb_delta - metrics[i].lsb_delta < -31 )
+          pen_x += 64;
+      }
+
+      if ( hinted )
+      {
+        pen_x = ( pen_x + 32 ) & -64;
+        pen_y = ( pen_y + 32 ) & -64;
+      }
+
+      pen_x += metrics[i].advance + track_kern;
+
+      prev           = gindex;
+      prev_rsb_delta = metrics[i].rsb_delta;
+      done++;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  /* load the glyphs of the layout once, outside of the timed sections */
+  static void
+  load_layout_metrics( FT_Face     face,
+                       blayout_t*  layout )
+  {
+    int  i;
+
+
+    for ( i = 0; i < layout->glyphs->size; i++ )
+    {
+      blayoutglyph_t*  m = &layout->metrics[i];
+
+
+      m->loaded = !FT_Load_Glyph( face,
+                                  (FT_UInt)layout->glyphs->code[i],
+                                  load_flags );
+      if ( !m->loaded )
+        continue;
+
+      m->advance   = face->glyph->metrics.horiAdvance;
+      m->lsb_delta = face->glyph->lsb_delta;
+      m->rsb_delta = face->glyph->rsb_delta;
+    }
+  }
+
+
+  /*
+   * Switch between the variation instances in `user_data', loading and
+   * rendering all glyphs and getting their advance widths after each
+   * switch.  Only one of these three steps gets timed, so that the costs
+   * of an instance switch and of the glyphs are reported separately.
+   */
+  static int
+  test_var( btimer_t*  timer,
+            FT_Face    face,
+            void*      user_data )
+  {
+    bvar_t*       var = (bvar_t*)user_data;
+    FT_Fixed*     advances;
+    FT_UInt       start, count;
+    unsigned int  i;
+    int           n, done = 0;
+
+
+    if ( incr_index > 0 )
+    {
+      start = first_index;
+      count = last_index - first_index + 1;
+    }
+    else
+    {
+      start = last_index;
+      count = first_index - last_index + 1;
+    }
+
+    advances = (FT_Fixed *)calloc( sizeof ( FT_Fixed ), (size_t)count );
+    if ( !advances )
+      return 0;
+
+    for ( n = 0; n < var->num_instances; n++ )
+    {
+      FT_Error  error;
+      int       loaded = 0;
+
+
+      if ( var->timed == VAR_TIME_SWITCH )
+        TIMER_START( timer );
+
+      error = FT_Set_Var_Design_Coordinates( face,
+                                             var->num_axes,
+                                             var->coords +
+                                               n * (int)var->num_axes );
+
+      if ( var->timed == VAR_TIME_SWITCH )
+      {
+        TIMER_STOP( timer );
+        if ( !error )
+          done++;
+      }
+
+      if ( error )
+        continue;
+
+      if ( var->timed == VAR_TIME_LOAD )
+        TIMER_START( timer );
+
+      FOREACH( i )
+      {
+        if ( FT_Load_Glyph( face, i, load_flags ) )
+          continue;
+        if ( face_size )
+          FT_Render_Glyph( face->glyph, render_mode );
+        loaded++;
+      }
+
+      if ( var->timed == VAR_TIME_LOAD )
+      {
+        TIMER_STOP_N( timer, loaded );
+        done += loaded;
+      }
+
+      if ( var->timed == VAR_TIME_ADVANCES )
+        TIMER_START( timer );
+
+      error = FT_Get_Advances( face, start, count, load_flags, advances );
+
+      if ( var->timed == VAR_TIME_ADVANCES )
+      {
+        TIMER_STOP_N( timer, error ? 0 : (int)count );
+        if ( !error )
+          done += (int)count;
+      }
+    }
+
+    free( advances );
+
+    return done;
+  }
+
+
+  /*
+   * Color glyphs: `user_data' points to the index of the color bitmap
+   * strike to use, or -1 for COLR fonts without color bitmaps.
+   */
+  static FT_Error
+  select_color_strike( FT_Face  face,
+                       FT_Int   strike )
+  {
+    return strike >= 0 ? FT_Select_Size( face, strike ) : FT_Err_Ok;
+  }
+
+
+  static void
+  restore_face_size( FT_Face  face,
+                     FT_Int   strike )
+  {
+    if ( strike >= 0 && face_size )
+      set_face_size( face );
+  }
+
+
+  static int
+  test_color_load( btimer_t*  timer,
+                   FT_Face    face,
+                   void*      user_data )
+  {
+    FT_Int        strike = *(FT_Int*)user_data;
+    unsigned int  i;
+    int           done = 0;
+
+
+    if ( select_color_strike( face, strike ) )
+      return 0;
+
+    FOREACH( i )
+    {
+      TIMER_START( timer );
+      if ( !FT_Load_Glyph( face, i,
+                           load_flags | FT_LOAD_COLOR | FT_LOAD_RENDER ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    restore_face_size( face, strike );
+
+    return done;
+  }
+
+
+  /* Scale a BGRA bitmap to `width' x `height' pixels with a box filter, */
+  /* as done by clients to fit color bitmaps to the text size.           */
+  static void
+  downscale_bgra( FT_Bitmap*      source,
+                  unsigned char*  target,
+                  unsigned int    width,
+                  unsigned int    height )
+  {
+    unsigned int  x, y;
+
+
+    for ( y = 0; y < height; y++ )
+    {
+      unsigned int  y0 = y * source->rows / height;
+      unsigned int  y1 = ( y + 1 ) * source->rows / height;
+
+
+      if ( y1 == y0 )
+        y1++;
+
+      for ( x = 0; x < width; x++ )
+      {
+        unsigned int  x0 = x * source->width / width;
+        unsigned int  x1 = ( x + 1 ) * source->width / width;
+        unsigned int  sum[4] = { 0, 0, 0, 0 };
+        unsigned int  sx, sy, count;
+
+
+        if ( x1 == x0 )
+          x1++;
+        count = ( x1 - x0 ) * ( y1 - y0 );
+
+        for ( sy = y0; sy < y1; sy++ )
+        {
+          unsigned char*  p = source->buffer + (int)sy * source->pitch +
+                                4 * x0;
+
+
+          for ( sx = x0; sx < x1; sx++, p += 4 )
+          {
+            sum[0] += p[0];
+            sum[1] += p[1];
+            sum[2] += p[2];
+            sum[3] += p[3];
+          }
+        }
+
+        *target++ = (unsigned char)( sum[0] / count );
+        *target++ = (unsigned char)( sum[1] / count );
+        *target++ = (unsigned char)( sum[2] / count );
+        *target++ = (unsigned char)( sum[3] / count );
+      }
+    }
+  }
+
+
+  static int
+  test_color_downscale( btimer_t*  timer,
+                        FT_Face    face,
+                        void*      user_data )
+  {
+    FT_Int          strike = *(FT_Int*)user_data;
+    FT_Pos          ppem;
+    unsigned char*  buffer = NULL;
+    size_t          buffer_size = 0;
+    unsigned int    i;
+    int             done = 0;
+
+
+    if ( select_color_strike( face, strike ) )
+      return 0;
+
+    ppem = face->available_sizes[strike].y_ppem;
+
+    FOREACH( i )
+    {
+      FT_Bitmap*    bitmap = &face->glyph->bitmap;
+      unsigned int  width, height;
+
+
+      if ( FT_Load_Glyph( face, i, load_flags | FT_LOAD_COLOR ) ||
+           bitmap->pixel_mode != FT_PIXEL_MODE_BGRA             ||
+           bitmap->pitch < 0                                    )
+        continue;
+
+      width  = (unsigned int)( ( bitmap->width * requested_size * 64 +
+                                 (unsigned int)ppem / 2 ) /
+                               (unsigned int)ppem );
+      height = (unsigned int)( ( bitmap->rows * requested_size * 64 +
+                                 (unsigned int)ppem / 2 ) /
+                               (unsigned int)ppem );
+      if ( !width || !height )
+        continue;
+
+      if ( 4 * width * height > buffer_size )
+      {
+        unsigned char*  new_buffer;
+
+
+        new_buffer = (unsigned char*)realloc( buffer, 4 * width * height );
+        if ( !new_buffer )
+          break;
+
+        buffer      = new_buffer;
+        buffer_size = 4 * width * height;
+      }
+
+      TIMER_START( timer );
+      downscale_bgra( bitmap, buffer, width, height );
+      TIMER_STOP( timer );
+
+      done++;
+    }
+
+    free( buffer );
+    restore_face_size( face, strike );
+
+    return done;
+  }
+
+
+  /* compose the COLR layers by hand, like `Render_All' in `ftview.c' */
+  static int
+  test_color_layers( btimer_t*  timer,
+                     FT_Face    face,
+                     void*      user_data )
+  {
+    FT_Color*     palette;
+    FT_Color      foreground = { 0, 0, 0, 255 };
+    FT_Int32      flags;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    if ( FT_Palette_Select( face, 0, &palette ) )
+      return 0;
+
+    /* render the layers in normal anti-aliasing mode */
+    flags  = load_flags & ~FT_LOAD_COLOR & ~FT_LOAD_TARGET_( 0xF );
+    flags |= FT_LOAD_RENDER | FT_LOAD_TARGET_NORMAL;
+
+    FOREACH( i )
+    {
+      FT_LayerIterator  iterator;
+      FT_UInt           layer_glyph, layer_color;
+      FT_Bitmap         bitmap;
+      FT_Vector         bitmap_offset = { 0, 0 };
+      FT_Error          error         = FT_Err_Ok;
+
+
+      iterator.p = NULL;
+      if ( !FT_Get_Color_Glyph_Layer( face, i,
+                                      &layer_glyph, &layer_color,
+                                      &iterator ) )
+        continue;
+
+      TIMER_START( timer );
+
+      iterator.p = NULL;
+      FT_Get_Color_Glyph_Layer( face, i,
+                                &layer_glyph, &layer_color,
+                                &iterator );
+
+      FT_Bitmap_Init( &bitmap );
+
+      do
+      {
+        FT_GlyphSlot  slot = face->glyph;
+        FT_Vector     slot_offset;
+
+
+        error = FT_Load_Glyph( face, layer_glyph, flags );
+        if ( error )
+          break;
+
+        slot_offset.x = slot->bitmap_left * 64;
+        slot_offset.y = slot->bitmap_top * 64;
+
+        /* 0xFFFF stands for the text color */
+        error = FT_Bitmap_Blend( lib,
+                                 &slot->bitmap,
+                                 slot_offset,
+                                 &bitmap,
+                                 &bitmap_offset,
+                                 layer_color == 0xFFFF
+                                   ? foreground
+                                   : palette[layer_color] );
+
+      } while ( !error                                         &&
+                FT_Get_Color_Glyph_Layer( face, i,
+                                          &layer_glyph, &layer_color,
+                                          &iterator ) );
+
+      FT_Bitmap_Done( lib, &bitmap );
+
+      TIMER_STOP( timer );
+
+      if ( !error )
+        done++;
+    }
+
+    return done;
+  }
+
+
+  /*
+   * Rendering an SDF can take milliseconds per glyph, so a call of
+   * `test_sdf' only renders the next `SDF_GLYPHS' glyphs of the range,
+   * allowing the time limit to be checked in between.
+   */
+#define SDF_GLYPHS  16
+
+  /* the next glyph index of `test_sdf' */
+  static THREAD_LOCAL unsigned int  sdf_index;
+
+
+  /* `user_data' is non-zero for the bitmap-based `bsdf' renderer */
+  static int
+  test_sdf( btimer_t*  timer,
+            FT_Face    face,
+            void*      user_data )
+  {
+    int           from_bitmap = *(int*)user_data;
+    unsigned int  i, n, count;
+    int           done = 0;
+
+
+    count = first_index <= last_index ? last_index - first_index + 1
+                                      : first_index - last_index + 1;
+    if ( count > SDF_GLYPHS )
+      count = SDF_GLYPHS;
+
+    /* restart if the range has changed */
+    i = sdf_index;
+    if ( !( first_index <= i && i <= last_index ) &&
+         !( first_index >= i && i >= last_index ) )
+      i = first_index;
+
+    for ( n = 0; n < count; n++ )
+    {
+      unsigned int  gindex = i;
+
+
+      i = i == last_index ? first_index : i + (unsigned int)incr_index;
+
+      if ( FT_Load_Glyph( face, gindex, load_flags ) )
+        continue;
+
+      /* the `bsdf' renderer converts an already rendered bitmap */
+      if ( from_bitmap                                              &&
+           FT_Render_Glyph( face->glyph, FT_RENDER_MODE_NORMAL ) )
+        continue;
+
+      TIMER_START( timer );
+      if ( !FT_Render_Glyph( face->glyph, FT_RENDER_MODE_SDF ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    sdf_index = i;
+
+    return done;
+  }
+
+
+
+  /*
+   * main
+   */
+
+  static void
+  get_charset( FT_Face      face,
+               bcharset_t*  charset )
+  {
+    FT_ULong  charcode;
+    FT_UInt   gindex;
+    int       i = 0;
+
+
+    charset->code = (FT_ULong*)calloc( (size_t)face->num_glyphs,
+                                       sizeof ( FT_ULong ) );
+    if ( !charset->code )
+      return;
+
+    if ( face->charmap )
+    {
+      charcode = FT_Get_First_Char( face, &gindex );
+
+      /* certain fonts contain a broken charmap that will map character */
+      /* codes to out-of-bounds glyph indices.  Take care of that here. */
+      /*                                                                */
+      while ( gindex && i < face->num_glyphs )
+      {
+        if ( ( first_index <= gindex && gindex <= last_index ) ||
+             ( first_index >= gindex && gindex >= last_index ) )
+          charset->code[i++] = charcode;
+        charcode = FT_Get_Next_Char( face, charcode, &gindex );
+      }
+    }
+    else
+    {
+      unsigned int  j;
+
+
+      /* no charmap, do an identity mapping */
+      FOREACH( j )
+        charset->code[i++] = j;
+    }
+
+    charset->size = i;
+  }
+
+
+  /* Read the UTF-8 file `text_file' into an array of code points, */
+  /* skipping control characters, byte order marks, and invalid    */
+  /* sequences.                                                    */
+  static int
+  get_text( bcharset_t*  text )
+  {
+    FILE*           file;
+    unsigned char*  buffer;
+    size_t          size, i;
+    FT_Int          n = 0;
+
+
+    text->size = 0;
+    text->code = NULL;
+
+    file = fopen( text_file, "rb" );
+    if ( file == NULL )
+    {
+      fprintf( stderr, "couldn't find or open `%s'\n", text_file );
+
+      return 1;
+    }
+
+    fseek( file, 0, SEEK_END );
+    size = (size_t)ftell( file );
+    fseek( file, 0, SEEK_SET );
+
+    buffer     = (unsigned char*)malloc( size + 1 );
+    text->code = (FT_ULong*)calloc( size + 1, sizeof ( FT_ULong ) );
+    if ( !buffer || !text->code )
+    {
+      fprintf( stderr, "couldn't allocate memory for text corpus\n" );
+      goto Fail;
+    }
+
+    if ( size && !fread( buffer, size, 1, file ) )
+    {
+      fprintf( stderr, "read error\n" );
+      goto Fail;
+    }
+
+    for ( i = 0; i < size; )
+    {
+      FT_ULong  c   = buffer[i++];
+      int       len = 0;
+
+
+      if ( c >= 0xF8 || ( c >= 0x80 && c < 0xC0 ) )
+        continue;
+      else if ( c >= 0xF0 )
+      {
+        c  &= 0x07;
+        len = 3;
+      }
+      else if ( c >= 0xE0 )
+      {
+        c  &= 0x0F;
+        len = 2;
+      }
+      else if ( c >= 0xC0 )
+      {
+        c  &= 0x1F;
+        len = 1;
+      }
+
+      for ( ; len && i < size && ( buffer[i] & 0xC0 ) == 0x80; len-- )
+        c = ( c << 6 ) | ( buffer[i++] & 0x3F );
+
+      if ( len || c < 0x20 || c == 0x7F || c == 0xFEFF )
+        continue;
+
+      text->code[n++] = c;
+    }
+
+    fclose( file );
+    free( buffer );
+
+    if ( !n )
+    {
+      fprintf( stderr, "no characters in `%s'\n", text_file );
+      free( text->code );
+      text->code = NULL;
+
+      return 1;
+    }
+
+    text->size = n;
+
+    return 0;
+
+  Fail:
+    fclose( file );
+    free( buffer );
+    free( text->code );
+    text->code = NULL;
+
+    return 1;
+  }
+
+
+  /* Load font file `filename' into memory as given by `mode'. */
+  static int
+  load_font_data( int        mode,
+                  FT_Byte**  adata,
+                  size_t*    asize )
+  {
+    FILE*     file;
+    FT_Byte*  data;
+    size_t    size;
+
+
+#ifdef FTBENCH_MMAP
+    if ( mode & PRELOAD_MMAP )
+    {
+      struct stat  st;
+      int          fd    = open( filename, O_RDONLY );
+      int          flags = MAP_PRIVATE;
+
+
+      if ( fd < 0 || fstat( fd, &st ) || !st.st_size )
+      {
+        fprintf( stderr, "couldn't find or open `%s'\n", filename );
+        if ( fd >= 0 )
+          close( fd );
+
+        return 1;
+      }
+      size = (size_t)st.st_size;
+
+#ifdef MAP_POPULATE
+      /* huge pages must be requested before the mapping gets populated */
+      if ( ( mode & PRELOAD_POPULATE ) && !( mode & PRELOAD_HUGE ) )
+        flags |= MAP_POPULATE;
+#endif
+
+      data = (FT_Byte*)mmap( NULL, size, PROT_READ, flags, fd, 0 );
+      close( fd );
+
+      if ( (void*)data == MAP_FAILED )
+      {
+        fprintf( stderr, "couldn't map font file into memory\n" );
+
+        return 1;
+      }
+
+#ifdef MADV_HUGEPAGE
+      if ( mode & PRELOAD_HUGE )
+        madvise( data, size, MADV_HUGEPAGE );
+#endif
+
+#ifdef MAP_POPULATE
+      if ( ( mode & PRELOAD_POPULATE ) && ( mode & PRELOAD_HUGE ) )
+#else
+      if ( mode & PRELOAD_POPULATE )
+#endif
+      {
+        volatile FT_Byte  sum  = 0;
+        size_t            page = (size_t)sysconf( _SC_PAGESIZE );
+        size_t            i;
+
+
+        for ( i = 0; i < size; i += page )
+          sum ^= data[i];
+      }
+
+      *adata = data;
+      *asize = size;
+
+      return 0;
+    }
+#else
+    FT_UNUSED( mode );
+#endif /* FTBENCH_MMAP */
+
+    file = fopen( filename, "rb" );
+    if ( file == NULL )
+    {
+      fprintf( stderr, "couldn't find or open `%s'\n", filename );
+
+      return 1;
+    }
+
+    fseek( file, 0, SEEK_END );
+    size = (size_t)ftell( file );
+    fseek( file, 0, SEEK_SET );
+
+    data = (FT_Byte*)malloc( size );
+    if ( data == NULL )
+    {
+      fprintf( stderr,
+               "couldn't allocate memory to pre-load font file\n" );
+      fclose( file );
+
+      return 1;
+    }
+
+    if ( !fread( data, size, 1, file ) )
+    {
+      fprintf( stderr, "read error\n" );
+      free( data );
+      fclose( file );
+
+      return 1;
+    }
+
+    fclose( file );
+
+    *adata = data;
+    *asize = size;
+
+    return 0;
+  }
+
+
+  static void
+  unload_font_data( int       mode,
+                    FT_Byte*  data,
+                    size_t    size )
+  {
+    if ( !data )
+      return;
+
+#ifdef FTBENCH_MMAP
+    if ( mode & PRELOAD_MMAP )
+    {
+      munmap( data, size );
+
+      return;
+    }
+#else
+    FT_UNUSED( mode );
+    FT_UNUSED( size );
+#endif
+
+    free( data );
+  }
+
+
+  /* Evict the font file from the OS page cache (option `-d'); pages */
+  /* still mapped by any process are not affected.                  */
+  static void
+  drop_page_cache( void )
+  {
+#ifdef FTBENCH_COLD_CACHE
+    int  fd = open( filename, O_RDONLY );
+
+
+    if ( fd >= 0 )
+    {
+      posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+      close( fd );
+    }
+#endif
+  }
+
+
+  static FT_Error
+  get_face( FT_Face*  face )
+  {
+    FT_Error  error;
+
+
+    /* In cold mode, the face used by all other tests is always read */
+    /* into memory: a mapping of the file (done by `FT_New_Face' on  */
+    /* Unix, too) would keep its pages in the page cache.            */
+    if ( preload || cold_cache )
+    {
+      if ( !font_data )
+      {
+        font_data_mode = cold_cache ? PRELOAD_READ : preload;
+
+        if ( load_font_data( font_data_mode, &font_data, &font_data_size ) )
+        {
+          font_data = NULL;
+
+          return 1;
+        }
+      }
+
+      error = FT_New_Memory_Face( lib,
+                                  font_data,
+                                  (FT_Long)font_data_size,
+                                  face_index,
+                                  face );
+    }
+    else
+      error = FT_New_Face( lib, filename, face_index, face );
+
+    if ( error )
+      fprintf( stderr, "couldn't load font resource\n");
+
+    return error;
+  }
+
+
+  /*
+   * Instrumented streams (option `-O'): the faces opened by tests `g' and
+   * `l' and by the I/O profile get a custom stream that counts all reads
+   * and seeks, optionally logs them, and optionally delays each read to
+   * emulate remote storage.
+   */
+
+  typedef struct  bstream_t_
+  {
+    FT_StreamRec  stream;
+    FILE*         file;  /* NULL if reading from `font_data' */
+    FT_Byte*      seen;  /* one bit per byte of the font file */
+
+  } bstream_t;
+
+
+  /* count the bytes of the range not read before, then mark them */
+  static unsigned long
+  stream_mark( bstream_t*     bs,
+               unsigned long  offset,
+               unsigned long  count )
+  {
+    unsigned long  n = 0;
+
+
+    if ( !bs->seen )
+      return 0;
+
+    for ( ; count > 0; offset++, count-- )
+    {
+      FT_Byte*  p    = bs->seen + ( offset >> 3 );
+      FT_Byte   mask = (FT_Byte)( 1 << ( offset & 7 ) );
+
+
+      if ( !( *p & mask ) )
+      {
+        *p |= mask;
+        n++;
+      }
+    }
+
+    return n;
+  }
+
+
+  static unsigned long
+  stream_read( FT_Stream       stream,
+               unsigned long   offset,
+               unsigned char*  buffer,
+               unsigned long   count )
+  {
+    bstream_t*     bs = (bstream_t*)stream;
+    unsigned long  n  = 0;
+
+
+    if ( io_trace )
+      fprintf( io_trace, "%s\t%s\t%lu\t%lu\n",
+               io_phase ? io_phase : "-",
+               count ? "read" : "seek",
+               offset,
+               count );
+
+    /* a seek only, to be answered with zero on success */
+    if ( !count )
+    {
+      if ( io_counts )
+        io_counts->seeks++;
+
+      return offset > stream->size;
+    }
+
+    if ( offset < stream->size )
+    {
+      if ( count > stream->size - offset )
+        count = stream->size - offset;
+
+      if ( !bs->file )
+      {
+        memcpy( buffer, font_data + offset, count );
+        n = count;
+      }
+      else if ( !fseek( bs->file, (long)offset, SEEK_SET ) )
+        n = (unsigned long)fread( buffer, 1, count, bs->file );
+    }
+
+#ifdef FTBENCH_IO_LATENCY
+    if ( io_latency > 0 )
+    {
+      struct timespec  ts;
+
+
+      ts.tv_sec  = (time_t)( io_latency / 1E6 );
+      ts.tv_nsec = (long)( 1000 * ( io_latency - 1E6 * (double)ts.tv_sec ) );
+      nanosleep( &ts, NULL );
+    }
+#endif
+
+    if ( io_counts )
+    {
+      io_counts->reads++;
+      io_counts->bytes    += n;
+      io_counts->distinct += stream_mark( bs, offset, n );
+    }
+
+    return n;
+  }
+
+
+  static void
+  stream_close( FT_Stream  stream )
+  {
+    bstream_t*  bs = (bstream_t*)stream;
+
+
+    if ( bs->file )
+      fclose( bs->file );
+    free( bs->seen );
+    free( bs );
+  }
+
+
+  /* open a face of the current font through an instrumented stream */
+  static FT_Error
+  get_stream_face( FT_Face*  face )
+  {
+    bstream_t*    bs;
+    FT_Open_Args  args;
+    FT_Error      error;
+
+
+    bs = (bstream_t*)calloc( 1, sizeof ( bstream_t ) );
+    if ( !bs )
+      return FT_Err_Out_Of_Memory;
+
+    /* in cold mode, the file must be read anew */
+    if ( font_data && !cold_cache )
+      bs->stream.size = font_data_size;
+    else
+    {
+      long  size;
+
+
+      bs->file = fopen( filename, "rb" );
+      if ( !bs->file )
+      {
+        fprintf( stderr, "couldn't open font file\n" );
+        free( bs );
+
+        return FT_Err_Cannot_Open_Resource;
+      }
+
+      fseek( bs->file, 0, SEEK_END );
+      size = ftell( bs->file );
+      bs->stream.size = size > 0 ? (unsigned long)size : 0;
+    }
+
+    bs->stream.read  = stream_read;
+    bs->stream.close = stream_close;
+    bs->seen         = (FT_Byte*)calloc( bs->stream.size / 8 + 1, 1 );
+
+    if ( io_counts )
+      io_counts->faces++;
+
+    args.flags  = FT_OPEN_STREAM;
+    args.stream = &bs->stream;
+
+    /* the stream gets closed by `FT_Done_Face', even on failure */
+    error = FT_Open_Face( lib, &args, face_index, face );
+    if ( error )
+      fprintf( stderr, "couldn't load font resource\n");
+
+    return error;
+  }
+
+
+  /*
+   * Report the reads of opening a face, of setting its size and loading
+   * the first glyph, and of loading all glyphs of the range afterwards
+   * (steady state), each run once.
+   */
+
+  static void
+  run_io_profile( void )
+  {
+    static const char*  titles[3] =
+    {
+      "I/O: New_Face",
+      "I/O: first glyph",
+      "I/O: all glyphs"
+    };
+
+    FT_Face       face = NULL;
+    btimer_t      timer;
+    bio_t         io[3];
+    bresult_t     result;
+    unsigned int  i;
+    int           phase;
+
+
+    timer.histo = NULL;
+    timer.perf  = NULL;
+    timer.mem   = NULL;
+
+    memset( io, 0, sizeof ( io ) );
+
+    for ( phase = 0; phase < 3; phase++ )
+    {
+      int  done = 0;
+
+
+      io_counts = &io[phase];
+      io_phase  = titles[phase];
+
+      TIMER_RESET( &timer );
+      TIMER_START( &timer );
+
+      switch ( phase )
+      {
+      case 0:
+        done = !get_stream_face( &face );
+        break;
+
+      case 1:
+        if ( ( !face_size || !set_face_size( face ) )          &&
+             !FT_Load_Glyph( face, first_index, load_flags ) )
+          done = 1;
+        break;
+
+      default:
+        FOREACH( i )
+        {
+          if ( !FT_Load_Glyph( face, i, load_flags ) )
+            done++;
+        }
+      }
+
+      TIMER_STOP( &timer );
+
+      io_counts = NULL;
+      io_phase  = NULL;
+
+      memset( &result, 0, sizeof ( result ) );
+      result.title = titles[phase];
+      result.done  = done;
+      result.time  = TIMER_GET( &timer );
+      result.io    = &io[phase];
+
+      report_start( result.title );
+      report_result( &result );
+
+      if ( !face )
+        break;
+    }
+
+    if ( face )
+      FT_Done_Face( face );
+  }
+
+
+  /* Open a new face for the New_Face tests.  In cold mode (option   */
+  /* `-d'), the font file is preloaded anew into `*adata', which the */
+  /* caller must release with `unload_font_data'.                   */
+  static FT_Error
+  get_new_face( FT_Face*   face,
+                FT_Byte**  adata,
+                size_t*    asize )
+  {
+    FT_Error  error;
+
+
+    *adata = NULL;
+    *asize = 0;
+
+    if ( use_streams )
+      return get_stream_face( face );
+
+    if ( !cold_cache )
+      return get_face( face );
+
+    if ( !preload )
+    {
+      error = FT_New_Face( lib, filename, face_index, face );
+      if ( error )
+        fprintf( stderr, "couldn't load font resource\n");
+
+      return error;
+    }
+
+    if ( load_font_data( preload, adata, asize ) )
+    {
+      *adata = NULL;
+
+      return 1;
+    }
+
+    error = FT_New_Memory_Face( lib,
+                                *adata,
+                                (FT_Long)*asize,
+                                face_index,
+                                face );
+    if ( error )
+    {
+      fprintf( stderr, "couldn't load font resource\n");
+      unload_font_data( preload, *adata, *asize );
+      *adata = NULL;
+    }
+
+    return error;
+  }
+
+
+  static void
+  set_index_range( FT_Face  face )
+  {
+    first_index = range_first;
+    last_index  = range_last;
+
+    if ( first_index >= (unsigned int)face->num_glyphs )
+      first_index = (unsigned int)face->num_glyphs - 1;
+    if ( last_index  >= (unsigned int)face->num_glyphs )
+      last_index  = (unsigned int)face->num_glyphs - 1;
+    incr_index  = last_index > first_index ? 1 : -1;
+  }
+
+
+  static void
+  set_library_properties( FT_Library  library )
+  {
+    if ( tt_interpreter_version >= 0 )
+      FT_Property_Set( library,
+                       "truetype",
+                       "interpreter-version", &tt_interpreter_version );
+
+    if ( ps_hinting_engine >= 0 )
+    {
+      FT_Property_Set( library,
+                       "cff",
+                       "hinting-engine", &ps_hinting_engine );
+      FT_Property_Set( library,
+                       "type1",
+                       "hinting-engine", &ps_hinting_engine );
+      FT_Property_Set( library,
+                       "t1cid",
+                       "hinting-engine", &ps_hinting_engine );
+    }
+
+    if ( lcd_filter_set )
+      FT_Library_SetLcdFilter( library, lcd_filter );
+
+    if ( sdf_spread >= 0 )
+    {
+      FT_Property_Set( library, "sdf", "spread", &sdf_spread );
+      FT_Property_Set( library, "bsdf", "spread", &sdf_spread );
+    }
+  }
+
+
+  static FT_Error
+  set_face_size( FT_Face  face )
+  {
+    if ( FT_IS_SCALABLE( face ) && char_size )
+      return FT_Set_Char_Size( face, char_size, char_size, 72, 72 );
+    else if ( FT_IS_SCALABLE( face ) )
+      return FT_Set_Pixel_Sizes( face, face_size, face_size );
+    else
+      return FT_Select_Size( face, 0 );
+  }
+
+
+  /*
+   * Variation tests
+   */
+
+#define VAR_RANDOM_INSTANCES  16
+
+#define PEEK_ULONG( p )  ( ( (FT_ULong)(p)[0] << 24 ) | \
+                           ( (FT_ULong)(p)[1] << 16 ) | \
+                           ( (FT_ULong)(p)[2] <<  8 ) | \
+                             (FT_ULong)(p)[3]         )
+
+
+  /* Rename the `HVAR' and `VVAR' tables of the current face in `data', */
+  /* so that FreeType doesn't find them; return how many were found.    */
+  static int
+  hide_metrics_variations( FT_Byte*  data,
+                           size_t    size )
+  {
+    FT_ULong  offset = 0;
+    FT_UInt   num_tables, i;
+    int       found = 0;
+
+
+    if ( size >= 12 && !memcmp( data, "ttcf", 4 ) )
+    {
+      FT_ULong  n = (FT_ULong)( face_index & 0xFFFF );
+
+
+      if ( 12 + 4 * n + 4 > size )
+        return 0;
+      offset = PEEK_ULONG( data + 12 + 4 * n );
+    }
+
+    if ( offset + 12 > size )
+      return 0;
+
+    num_tables = ( (FT_UInt)data[offset + 4] << 8 ) | data[offset + 5];
+
+    for ( i = 0; i < num_tables; i++ )
+    {
+      FT_Byte*  tag = data + offset + 12 + 16 * i;
+
+
+      if ( offset + 12 + 16 * i + 16 > size )
+        break;
+
+      if ( !memcmp( tag, "HVAR", 4 ) || !memcmp( tag, "VVAR", 4 ) )
+      {
+        tag[0] = (FT_Byte)( tag[0] - 'A' + 'a' );
+        found++;
+      }
+    }
+
+    return found;
+  }
+
+
+  /* Open the current face again, without metrics variations tables; */
+  /* `*adata' must be released with `unload_font_data'.              */
+  static FT_Error
+  get_face_without_hvar( FT_Face*   aface,
+                         FT_Byte**  adata,
+                         size_t*    asize )
+  {
+    FT_Error  error;
+
+
+    *aface = NULL;
+
+    if ( load_font_data( PRELOAD_READ, adata, asize ) )
+    {
+      *adata = NULL;
+
+      return FT_Err_Cannot_Open_Resource;
+    }
+
+    if ( !hide_metrics_variations( *adata, *asize ) )
+      return FT_Err_Table_Missing;
+
+    error = FT_New_Memory_Face( lib,
+                                *adata,
+                                (FT_Long)*asize,
+                                face_index,
+                                aface );
+    if ( !error && face_size )
+      error = set_face_size( *aface );
+
+    return error;
+  }
+
+
+  /*
+   * Get the design coordinates of the instances to switch between:
+   * random ones within the axis ranges, or the ones in the file of option
+   * `-V'.  Each line of the latter holds the values of one instance, in
+   * axis order or as `TAG=VALUE'; missing ones use the axis default.
+   */
+  static const char*
+  get_var_instances( FT_Face  face,
+                     bvar_t*  var )
+  {
+    FT_MM_Var*   mm;
+    FILE*        file  = NULL;
+    FT_UInt32    state = 2463534242UL;
+    const char*  status = NULL;
+    int          max   = VAR_RANDOM_INSTANCES;
+    FT_UInt      a;
+
+
+    var->num_instances = 0;
+    var->coords        = NULL;
+    var->saved         = NULL;
+
+    if ( !FT_HAS_MULTIPLE_MASTERS( face ) || FT_Get_MM_Var( face, &mm ) )
+      return "not a variation font";
+
+    var->num_axes = mm->num_axis;
+    var->saved    = (FT_Fixed*)calloc( mm->num_axis, sizeof ( FT_Fixed ) );
+    if ( !var->saved )
+    {
+      status = "couldn't allocate instances";
+      goto Exit;
+    }
+    FT_Get_Var_Design_Coordinates( face, mm->num_axis, var->saved );
+
+    if ( var_file )
+    {
+      file = fopen( var_file, "r" );
+      if ( !file )
+      {
+        status = "couldn't open instance file (option `-V')";
+        goto Exit;
+      }
+    }
+
+    while ( 1 )
+    {
+      FT_Fixed*  coords;
+      char       line[1024];
+      char*      p    = line;
+      FT_UInt    axis = 0;
+
+
+      if ( file )
+      {
+        char  c;
+
+
+        if ( !fgets( line, sizeof ( line ), file ) )
+          break;
+        if ( line[0] == '#' || sscanf( line, " %c", &c ) != 1 )
+          continue;
+      }
+      else if ( var->num_instances == VAR_RANDOM_INSTANCES )
+        break;
+
+      if ( var->num_instances == 0 || var->num_instances == max )
+      {
+        FT_Fixed*  new_coords;
+
+
+        if ( var->num_instances )
+          max *= 2;
+        new_coords = (FT_Fixed*)realloc( var->coords,
+                                         (size_t)max * mm->num_axis *
+                                           sizeof ( FT_Fixed ) );
+        if ( !new_coords )
+        {
+          status = "couldn't allocate instances";
+          goto Exit;
+        }
+        var->coords = new_coords;
+      }
+
+      coords = var->coords + var->num_instances * (int)mm->num_axis;
+      var->num_instances++;
+
+      for ( a = 0; a < mm->num_axis; a++ )
+      {
+        FT_Var_Axis*  axis_rec = mm->axis + a;
+
+
+        if ( file )
+          coords[a] = axis_rec->def;
+        else
+          coords[a] = axis_rec->minimum +
+                        (FT_Fixed)( ( axis_rec->maximum - axis_rec->minimum ) *
+                                    ( next_random( &state ) / 4294967296.0 ) );
+      }
+
+      while ( file )
+      {
+        char    tag[5];
+        double  value;
+        int     n;
+
+
+        if ( sscanf( p, " %4[A-Za-z0-9]=%lf%n", tag, &value, &n ) == 2 )
+        {
+          FT_ULong  t;
+
+
+          while ( strlen( tag ) < 4 )
+            strcat( tag, " " );
+          t = FT_MAKE_TAG( tag[0], tag[1], tag[2], tag[3] );
+
+          for ( axis = 0; axis < mm->num_axis; axis++ )
+            if ( mm->axis[axis].tag == t )
+              break;
+        }
+        else if ( sscanf( p, " %lf%n", &value, &n ) != 1 )
+          break;
+
+        if ( axis < mm->num_axis )
+          coords[axis++] = (FT_Fixed)( value * 65536.0 );
+        p += n;
+      }
+    }
+
+    if ( !var->num_instances )
+      status = "no instances (option `-V')";
+
+  Exit:
+    if ( file )
+      fclose( file );
+    FT_Done_MM_Var( lib, mm );
+
+    return status;
+  }
+
+
+  static void
+  free_var_instances( bvar_t*  var )
+  {
+    free( var->coords );
+    free( var->saved );
+  }
+
+
+  /*
+   * Create the calling thread's library, face, and cache manager for
+   * `filename' and `face_index'.  This is used by the worker threads of
+   * the multi-threaded and the corpus modes; `close_font' releases
+   * everything again.
+   */
+
+  static FT_Error
+  open_font( FT_Face*  aface )
+  {
+    FT_Face   face = NULL;
+    FT_Error  error;
+
+
+    *aface = NULL;
+
+    error = new_library( &lib );
+    if ( error )
+      return error;
+
+    set_library_properties( lib );
+
+    error = get_face( &face );
+    if ( error )
+      return error;
+
+    set_index_range( face );
+
+    font_type.face_id = (FTC_FaceID)1;
+    font_type.width   = face_size;
+    font_type.height  = face_size;
+    font_type.flags   = load_flags;
+
+    if ( face_size )
+    {
+      error = set_face_size( face );
+      if ( error )
+        return error;
+
+      /* non-scalable fonts use their first bitmap strike */
+      if ( !FT_IS_SCALABLE( face ) )
+      {
+        font_type.width  = (FT_UInt)face->available_sizes[0].size >> 6;
+        font_type.height = font_type.width;
+      }
+    }
+
+    error = FTC_Manager_New( lib,
+                             0,
+                             max_sizes,
+                             max_bytes,
+                             face_requester,
+                             face,
+                             &cache_man );
+    if ( error )
+      return error;
+
+    *aface = face;
+
+    return FT_Err_Ok;
+  }
+
+
+  static void
+  close_font( void )
+  {
+    /* see the comment at the end of `main' */
+    if ( cache_man )
+      FTC_Manager_Done( cache_man );
+    if ( lib )
+      done_library( lib );
+
+    lib         = NULL;
+    cache_man   = NULL;
+    cmap_cache  = NULL;
+    image_cache = NULL;
+    sbit_cache  = NULL;
+
+    unload_font_data( font_data_mode, font_data, font_data_size );
+    font_data = NULL;
+  }
+
+
+#ifdef FTBENCH_THREADS
+
+  /*
+   * Multi-threaded mode
+   */
+
+  typedef struct  bthread_t_
+  {
+    pthread_t   id;
+    int         index;
+    char*       filename;
+    FT_Long     face_index;
+    btest_t*    test;
+    int         max_iter;
+    double      max_time;
+
+    FT_Error    error;
+    int         done;
+    double      time;
+    bhisto_t    histo;
+    bsamples_t  samples;
+    bperf_t     perf;
+    bmem_t      mem;
+    double      lookups;
+    double      misses;
+    double      locks;
+    double      lock_wait;
+    double      lock_hold;
+
+  } bthread_t;
+
+
+  static pthread_mutex_t  thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t   thread_cond  = PTHREAD_COND_INITIALIZER;
+  static int              threads_ready;
+  static int              threads_go;
+
+
+  static void*
+  bench_thread( void*  arg )
+  {
+    bthread_t*  thread = (bthread_t*)arg;
+    btest_t*    test   = thread->test;
+    FT_Face     face   = NULL;
+    btimer_t    timer;
+
+
+    timer.histo = NULL;
+    timer.perf  = NULL;
+    timer.mem   = NULL;
+
+    /* `lib', `cache_man', etc. are thread-local */
+    filename   = thread->filename;
+    face_index = thread->face_index;
+
+    if ( shared_cache )
+    {
+      face        = shared_cache->face;
+      cache_man   = shared_cache->manager;
+      cmap_cache  = shared_cache->cmap_cache;
+      image_cache = shared_cache->image_cache;
+      sbit_cache  = shared_cache->sbit_cache;
+      font_type   = shared_cache->font_type;
+      first_index = shared_cache->first_index;
+      last_index  = shared_cache->last_index;
+      incr_index  = shared_cache->incr_index;
+
+      thread->error = FT_Err_Ok;
+    }
+    else
+      thread->error = open_font( &face );
+
+    pin_thread( thread->index );
+    if ( !thread->error )
+      bench_warmup( face, test );
+
+    /* wait until all threads are ready to start */
+    pthread_mutex_lock( &thread_mutex );
+    threads_ready++;
+    pthread_cond_broadcast( &thread_cond );
+    while ( !threads_go )
+      pthread_cond_wait( &thread_cond, &thread_mutex );
+    pthread_mutex_unlock( &thread_mutex );
+
+    if ( !thread->error )
+    {
+      if ( use_perf_events )
+      {
+        perf_open( &thread->perf );
+        timer.perf = &thread->perf;
+      }
+
+      if ( count_allocs )
+        timer.mem = &thread->mem;
+
+      timer.histo = &thread->histo;
+      bench_reset( &timer );
+
+      thread->done = bench_loop( face,
+                                 test,
+                                 &timer,
+                                 &thread->samples,
+                                 thread->max_iter,
+                                 thread->max_time );
+      thread->time      = TIMER_GET( &timer );
+      thread->lookups   = timer.lookups;
+      thread->misses    = timer.misses;
+      thread->locks     = timer.locks;
+      thread->lock_wait = timer.lock_wait;
+      thread->lock_hold = timer.lock_hold;
+
+      if ( timer.perf )
+        perf_close( timer.perf );
+    }
+
+    /* the shared objects belong to the main thread */
+    if ( shared_cache )
+    {
+      cache_man   = NULL;
+      cmap_cache  = NULL;
+      image_cache = NULL;
+      sbit_cache  = NULL;
+    }
+
+    close_font();
+
+    return NULL;
+  }
+
+
+  /*
+   * Run `test' with 1, 2, ..., `num_threads' threads simultaneously.
+   * Per-thread timing uses the threads' CPU time as usual; the aggregate
+   * throughput is computed from the wall-clock time between the start of
+   * the first and the end of the last thread.  The scaling efficiency is
+   * the aggregate throughput relative to N times the single-thread
+   * throughput.
+   */
+
+  static void
+  benchmark_threads( btest_t*  test,
+                     int       max_iter,
+                     double    max_time )
+  {
+    static bhisto_t    histo;
+    static bsamples_t  samples;
+    static bperf_t     perf;
+    static bmem_t      mem;
+
+    bthread_t*  threads;
+    bresult_t   result;
+    double      base = 0.0;
+    int         n, i;
+
+
+    threads = (bthread_t*)calloc( (size_t)num_threads, sizeof ( bthread_t ) );
+    if ( !threads )
+    {
+      report_skip( test->title, "couldn't allocate thread data" );
+
+      return;
+    }
+
+    report_start( test->title );
+
+    for ( n = 1; n <= num_threads; n++ )
+    {
+      double  start;
+      int     created, failed = 0;
+
+
+      threads_ready = 0;
+      threads_go    = 0;
+
+      for ( i = 0; i < n; i++ )
+      {
+        threads[i].index      = i;
+        threads[i].filename   = filename;
+        threads[i].face_index = face_index;
+        threads[i].test       = test;
+        threads[i].max_iter   = max_iter;
+        threads[i].max_time   = max_time;
+        threads[i].error      = FT_Err_Ok;
+        threads[i].done       = 0;
+        threads[i].time       = 0.0;
+
+        if ( pthread_create( &threads[i].id,
+                             NULL,
+                             bench_thread,
+                             &threads[i] ) )
+          break;
+      }
+      created = i;
+
+      pthread_mutex_lock( &thread_mutex );
+      while ( threads_ready < created )
+        pthread_cond_wait( &thread_cond, &thread_mutex );
+      threads_go = 1;
+      start      = bench_wall_time();
+      pthread_cond_broadcast( &thread_cond );
+      pthread_mutex_unlock( &thread_mutex );
+
+      memset( &result, 0, sizeof ( result ) );
+      histo_reset( &histo );
+      bench_samples_reset( &samples );
+      memset( &perf, 0, sizeof ( perf ) );
+      memset( &mem, 0, sizeof ( mem ) );
+
+      for ( i = 0; i < created; i++ )
+      {
+        pthread_join( threads[i].id, NULL );
+
+        if ( threads[i].error )
+          failed++;
+        result.done    += threads[i].done;
+        result.time    += threads[i].time;
+        result.lookups   += threads[i].lookups;
+        result.misses    += threads[i].misses;
+        result.locks     += threads[i].locks;
+        result.lock_wait += threads[i].lock_wait;
+        result.lock_hold += threads[i].lock_hold;
+        histo_merge( &histo, &threads[i].histo );
+        bench_samples_merge( &samples, &threads[i].samples );
+        perf_merge( &perf, &threads[i].perf );
+        mem_merge( &mem, &threads[i].mem );
+      }
+
+      result.title   = test->title;
+      result.threads = n;
+
+      result.lookup_unit = test->lookup_unit;
+      result.wall    = bench_wall_time() - start;
+      result.histo   = &histo;
+      result.samples = &samples;
+      result.perf    = use_perf_events ? &perf : NULL;
+      result.mem     = count_allocs ? &mem : NULL;
+
+      if ( created < n )
+        result.status = "couldn't create threads";
+      else if ( failed )
+        result.status = "threads failed to initialize";
+      else if ( result.done )
+      {
+        if ( n == 1 )
+          base = result.done / result.wall;
+        result.efficiency = result.done / result.wall / ( n * base );
+      }
+
+      report_result( &result );
+
+      if ( result.status || !result.done )
+        break;
+    }
+
+    free( threads );
+  }
+
+
+  /*
+   * Run the cached `test' again with 1, 2, ..., `num_threads' threads
+   * that share the caches of the main thread (option `-G').  A warmup in
+   * the main thread creates and fills the caches, so that the requester
+   * of a face is never called in a worker thread.
+   */
+
+  static void
+  benchmark_shared( FT_Face   face,
+                    btest_t*  test,
+                    int       max_iter,
+                    double    max_time )
+  {
+    static bshared_t  shared;
+    static int        initialized;
+
+    btest_t  shared_test;
+    char     title[128];
+
+
+    if ( !initialized )
+    {
+      if ( pthread_mutex_init( &shared.mutex, NULL ) )
+      {
+        report_skip( test->title, "couldn't create mutex" );
+
+        return;
+      }
+
+      initialized = 1;
+    }
+
+    bench_warmup( face, test );
+
+    shared.face        = face;
+    shared.manager     = cache_man;
+    shared.cmap_cache  = cmap_cache;
+    shared.image_cache = image_cache;
+    shared.sbit_cache  = sbit_cache;
+    shared.font_type   = font_type;
+    shared.first_index = first_index;
+    shared.last_index  = last_index;
+    shared.incr_index  = incr_index;
+
+    snprintf( title, sizeof ( title ), "%s [shared]", test->title );
+
+    shared_test       = *test;
+    shared_test.title = title;
+
+    shared_cache = &shared;
+    benchmark_threads( &shared_test, max_iter, max_time );
+    shared_cache = NULL;
+  }
+
+#endif /* FTBENCH_THREADS */
+
+
+  /*
+   * Parse a comma-separated list of positive numbers into `values'; a
+   * range `I-J' stands for I, 2I, 4I, ... up to J, and `I-J*F' for I,
+   * F*I, F*F*I, ... up to J.  Return the number of values, or -1 for
+   * syntax errors.
+   */
+  static int
+  parse_list( const char*  list,
+              double*      values,
+              int          max_values )
+  {
+    int  num_values = 0;
+
+
+    while ( *list )
+    {
+      size_t  len    = strcspn( list, "," );
+      double  factor = 2;
+      double  lo, hi;
+      int     n;
+
+
+      n = sscanf( list, "%lf-%lf*%lf", &lo, &hi, &factor );
+      if ( n < 1 || lo <= 0 || ( n >= 2 && hi < lo ) || factor <= 1 )
+        return -1;
+      if ( n == 1 )
+        hi = lo;
+
+      /* allow for rounding errors of fractional factors */
+      for ( ; lo <= hi * 1.000001 && num_values < max_values; lo *= factor )
+        values[num_values++] = lo;
+
+      list += len;
+      if ( *list )
+        list++;
+    }
+
+    return num_values;
+  }
+
+
+  /* Parse a positive duration with an optional unit suffix (`s', `m', */
+  /* `h', or `d') into seconds; return -1 for syntax errors.           */
+  static double
+  parse_duration( const char*  s )
+  {
+    char*   end;
+    double  t = strtod( s, &end );
+
+
+    if ( end == s || t <= 0 )
+      return -1;
+
+    switch ( *end )
+    {
+    case '\0':
+    case 's':
+      break;
+    case 'm':
+      t *= 60;
+      break;
+    case 'h':
+      t *= 3600;
+      break;
+    case 'd':
+      t *= 86400;
+      break;
+    default:
+      return -1;
+    }
+
+    if ( *end && end[1] )
+      return -1;
+
+    return t;
+  }
+
+
+  static void
+  usage( void )
+  {
+    int   i;
+    char  interpreter_versions[32];
+    char  hinting_engines[32];
+    char  clock_names[64];
+
+
+    /* we expect that at least one interpreter version is available */
+    if ( num_tt_interpreter_versions == 2 )
+      snprintf( interpreter_versions, sizeof ( interpreter_versions ),
+                "%u and %u",
+                tt_interpreter_versions[0],
+                tt_interpreter_versions[1] );
+    else
+      snprintf( interpreter_versions, sizeof ( interpreter_versions ),
+                "%u, %u, and %u",
+                tt_interpreter_versions[0],
+                tt_interpreter_versions[1],
+                tt_interpreter_versions[2] );
+
+    /* we expect that at least one hinting engine is available */
+    if ( num_ps_hinting_engines == 1 )
+      snprintf( hinting_engines, sizeof ( hinting_engines ),
+                "`%s'",
+                ps_hinting_engine_names[ps_hinting_engines[0]] );
+    else
+      snprintf( hinting_engines, sizeof ( hinting_engines ),
+                "`%s' and `%s'",
+                ps_hinting_engine_names[ps_hinting_engines[0]],
+                ps_hinting_engine_names[ps_hinting_engines[1]] );
+
+    clock_names[0] = '\0';
+    for ( i = 0; clocks[i].name; i++ )
+    {
+      if ( i )
+        strcat( clock_names, clocks[i + 1].name ? ", " : ", or " );
+      strcat( clock_names, "`" );
+      strcat( clock_names, clocks[i].name );
+      strcat( clock_names, "'" );
+    }
+
+
+    fprintf( stderr,
+      "\n"
+      "ftbench: run FreeType benchmarks\n"
+      "--------------------------------\n"
+      "\n"
+      "Usage: ftbench [options] fontname...\n"
+      "\n"
+      "  With more than one font file or with a directory (searched\n"
+      "  recursively), all faces and named instances of all fonts are\n"
+      "  benchmarked and ranked by their relative cost (corpus mode).\n"
+      "\n"
+      "  -A CPU    Pin the benchmark to CPU number CPU; with option `-j' or\n"
+      "            in corpus mode, the Nth thread is pinned to CPU + N - 1\n"
+      "            (Linux).\n"
+      "  -a        Count the allocations of FreeType and report allocations,\n"
+      "            frees, and bytes per operation, and the peak number of\n"
+      "            bytes allocated during each test.\n"
+      "  -B FILE   Save per-test samples as a baseline to FILE.\n"
+      "  -C        Compare with cached version (if available).\n"
+      "  -c N      Use at most N iterations for each test\n"
+      "            (0 means time limited).\n"
+      "  -D US     With option `-O', delay each read by US microseconds\n"
+      "            (all times are then wall-clock times).\n"
+      "  -d        Drop the font file from the page cache before each\n"
+      "            iteration of tests `g', `l', and `s' (cold cache); all\n"
+      "            times are then wall-clock times.\n"
+      "  -E PCT    Repeat each test until the 95%% confidence interval of the\n"
+      "            time per operation is within +-PCT percent (at least\n"
+      "            3 times, see options `-k' and `-L').\n"
+      "  -e        Also report hardware performance counters per operation\n"
+      "            (cycles, instructions, cache and branch misses; Linux).\n"
+      "  -F FMT    Output format: `text' (default), `json', or `csv'.\n"
+      "            The latter two emit one record per test.\n"
+      "  -f L      Use hex number L as load flags (see `FT_LOAD_XXX').\n"
+      "  -G        With option `-j', run the cached tests again with all\n"
+      "            threads sharing one cache manager under a global lock;\n"
+      "            report lock wait and hold times.\n"
+      "  -H NAME   Use PS hinting engine NAME.\n"
+      "            Available versions are %s; default is `%s'.\n"
+      "  -I VER    Use TT interpreter version VER.\n"
+      "            Available versions are %s; default is version %u.\n"
+      "  -i I-J    Forward or reverse range of glyph indices to use\n"
+      "            (default is from 0 to the number of glyphs minus one).\n"
+      "  -j N      Run each test with 1, 2, ..., N threads simultaneously,\n"
+      "            each using its own library, face, and cache manager;\n"
+      "            report aggregate throughput and scaling efficiency.\n"
+      "  -K CLOCK  Use CLOCK for timing: %s\n"
+      "            (default is `cpu', the thread's CPU time).\n"
+      "  -k N      Repeat each test N times (default is 1, at most %d) and\n"
+      "            reject outlying repetitions; each repetition is limited\n"
+      "            by options `-c' and `-t'.\n"
+      "  -L T      With option `-E', stop repeating after T seconds\n"
+      "            (default is %.0f).\n"
+      "  -l N      Set LCD filter to N\n"
+      "              0: none, 1: default, 2: light, 16: legacy\n"
+      "  -M LIST   Sweep the cached lookups of tests `a' and `e' over the\n"
+      "            comma-separated cache sizes in LIST (KiByte; `I-J' gives\n"
+      "            I, 2I, 4I, ... up to J) and over several access patterns\n"
+      "            (sequential, random, Zipf, and the text of option `-u').\n"
+      "  -m M      Set maximum cache size to M KiByte (default is %d).\n",
+             hinting_engines,
+             ps_hinting_engine_names[dflt_ps_hinting_engine],
+             interpreter_versions,
+             dflt_tt_interpreter_version,
+             clock_names,
+             MAX_REPEATS,
+             REPEAT_TIME,
+             CACHE_SIZE );
+    fprintf( stderr,
+      "  -O        Open the faces of tests `g', `l', and `s' through a\n"
+      "            stream that counts all reads, and report the reads of\n"
+      "            opening a face, loading the first glyph, and loading all\n"
+      "            glyphs.\n"
+      "  -o FILE   With option `-O', log all reads and seeks to FILE.\n"
+      "  -P MODE   Preload font file in memory using MODE, a comma-separated\n"
+      "            list of `read' (same as `-p'), `mmap', `populate' (prefault\n"
+      "            the mapping), and `huge' (ask for huge pages).\n"
+      "  -p        Preload font file in memory.\n"
+      "  -Q T      Soak mode: run a random mix of glyph loading at random\n"
+      "            sizes, cache lookups, and opening and closing faces for\n"
+      "            T seconds (or minutes, hours, days with suffix `m', `h',\n"
+      "            `d'); report throughput, resident set size, and heap\n"
+      "            bytes of FreeType per interval; flag steady growth.\n"
+      "  -q T      Use T seconds as the interval of option `-Q'\n"
+      "            (default is %.0f).\n"
+      "  -R FILE   Compare results with the baseline in FILE, using the\n"
+      "            Mann-Whitney U test; exit with code 2 if any test\n"
+      "            regressed significantly.\n"
+      "  -r N      Set render mode to N\n"
+      "              0: normal, 1: light, 2: mono, 3: LCD, 4: LCD vertical\n"
+      "            (default is 0).\n"
+      "  -S LIST   Use the spreads in LIST for test `%c' (default is 8).\n"
+      "  -s S      Use S ppem as face size (default is %dppem).\n"
+      "            If set to zero, don't call FT_Set_Pixel_Sizes.\n"
+      "            Use value 0 with option `-f 1' or something similar to\n"
+      "            load the glyphs unscaled, otherwise errors will show up.\n",
+             SOAK_INTERVAL,
+             'a' + FT_BENCH_SDF,
+             FACE_SIZE );
+    fprintf( stderr,
+      "  -T PCT    With options `-R' and `-y', ignore changes of the time\n"
+      "            smaller than PCT percent (default is %.0f).\n"
+      "  -t T      Use at most T seconds per bench (default is %.0f).\n"
+      "  -u FILE   Use the UTF-8 text in FILE as the corpus for test `%c'.\n"
+      "  -V FILE   Use the variation instances in FILE for test `%c', one\n"
+      "            per line, given as axis values or as `TAG=VALUE' pairs\n"
+      "            (default is %d random instances).\n"
+      "\n"
+      "  -b tests  Perform chosen tests (default is `a' to `%c'):\n",
+             regression_threshold,
+             BENCH_TIME,
+             'a' + FT_BENCH_TEXT,
+             'a' + FT_BENCH_VARIATION,
+             VAR_RANDOM_INSTANCES,
+             'a' + N_FT_BENCH_DEFAULT - 1 );
+
+    for ( i = 0; i < N_FT_BENCH; i++ )
+    {
+      if ( !bench_desc[i] )
+        break;
+
+      fprintf( stderr,
+      "              %c  %s\n", 'a' + i, bench_desc[i] );
+    }
+
+    fprintf( stderr,
+      "\n"
+      "  -v        Show version.\n"
+      "  -W N      Run N untimed warm-up iterations before each test\n"
+      "            (default is 0).\n"
+      "  -w N      Use N worker threads in corpus mode (default is 1).\n"
+      "  -X DIMS   Run the tests for all combinations of the hinting\n"
+      "            settings in DIMS, any of `i' (TT interpreter versions),\n"
+      "            `h' (PS hinting engines), `t' (load targets), `a'\n"
+      "            (auto-hinter off and on), and `l' (LCD filters), and\n"
+      "            report one table.\n"
+      "  -y A,B    Load the FreeType libraries A and B (paths of shared\n"
+      "            objects) and compare them with tests `a' to `k' in\n"
+      "            alternating time slices; report the speedup of B with\n"
+      "            its 95%% confidence interval and exit with code 2 if B\n"
+      "            is significantly slower.\n"
+      "  -Z LIST   Run tests `a', `c', and `i' for the sizes in LIST (in\n"
+      "            pixels, fractional ones allowed) and report time and\n"
+      "            allocated bytes per operation for each size.\n"
+      "  -z LIST   Use the sizes in LIST (in pixels) for test `%c'\n"
+      "            (default is the face size); `I-J' doubles from I to J,\n"
+      "            `I-J*F' multiplies by F.\n"
+      "\n",
+             'a' + FT_BENCH_SDF );
+
+    exit( 1 );
+  }
+
+
+  /* without option `-b', run the tests up to `N_FT_BENCH_DEFAULT' */
+#define TEST( x )  ( test_string ? strchr( test_string, (x) ) != NULL  \
+                                 : (x) < 'a' + N_FT_BENCH_DEFAULT      )
+
+
+  /* Return the color bitmap strike (`CBDT' or `sbix') to use for the  */
+  /* color tests: the smallest one not smaller than option `-s', or   */
+  /* the largest one.  Return -1 if there are no color bitmaps.        */
+  static FT_Int
+  get_color_strike( FT_Face  face )
+  {
+    FT_ULong  length = 0;
+    FT_Int    i, strike = -1;
+    FT_Pos    size = (FT_Pos)requested_size * 64;
+
+
+    if ( !FT_HAS_COLOR( face )                                       ||
+         !FT_HAS_FIXED_SIZES( face )                                 ||
+         ( FT_Load_Sfnt_Table( face, TTAG_CBDT, 0, NULL, &length ) &&
+           FT_Load_Sfnt_Table( face, TTAG_sbix, 0, NULL, &length ) ) )
+      return -1;
+
+    for ( i = 0; i < face->num_fixed_sizes; i++ )
+    {
+      FT_Pos  ppem = face->available_sizes[i].y_ppem;
+      FT_Pos  best = strike < 0 ? 0 : face->available_sizes[strike].y_ppem;
+
+
+      if ( strike < 0                    ||
+           ( best < size && ppem > best ) ||
+           ( ppem >= size && ppem < best ) )
+        strike = i;
+    }
+
+    return strike;
+  }
+
+
+  /* run all selected tests on `face' */
+  static void
+  run_tests( FT_Face  face,
+             int      max_iter,
+             double   max_time )
+  {
+    int  j;
+
+
+    for ( j = 0; j < N_FT_BENCH; j++ )
+    {
+      btest_t   test;
+      FT_ULong  flags;
+
+
+      if ( !TEST( 'a' + j ) )
+        continue;
+
+      test.title       = NULL;
+      test.bench       = NULL;
+      test.cache_first = 0;
+      test.user_data   = NULL;
+      test.lookup_unit = NULL;
+
+      switch ( j )
+      {
+      case FT_BENCH_LOAD_GLYPH:
+        test.title = "Load";
+        test.bench = test_load;
+        benchmark( face, &test, max_iter, max_time );
+
+        if ( compare_cached )
+        {
+          test.cache_first = 1;
+
+          test.title = "Load (image cached)";
+          test.bench = test_image_cache;
+          benchmark( face, &test, max_iter, max_time );
+
+          test.title = "Load (sbit cached)";
+          test.bench = test_sbit_cache;
+          if ( face_size )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title, "disabled (size = 0)" );
+        }
+        break;
+
+      case FT_BENCH_LOAD_ADVANCES:
+        test.user_data = &flags;
+
+        test.title = "Load_Advances (Normal)";
+        test.bench = test_load_advances;
+        flags      = FT_LOAD_DEFAULT;
+        benchmark( face, &test, max_iter, max_time );
+
+        test.title  = "Load_Advances (Fast)";
+        test.bench  = test_load_advances;
+        flags       = FT_LOAD_TARGET_LIGHT;
+        benchmark( face, &test, max_iter, max_time );
+
+        test.title  = "Load_Advances (Unscaled)";
+        test.bench  = test_load_advances;
+        flags       = FT_LOAD_NO_SCALE;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_RENDER:
+        test.title = "Render";
+        test.bench = test_render;
+        if ( face_size )
+          benchmark( face, &test, max_iter, max_time );
+        else
+          report_skip( test.title, "disabled (size = 0)" );
+        break;
+
+      case FT_BENCH_GET_GLYPH:
+        test.title = "Get_Glyph";
+        test.bench = test_get_glyph;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_GET_CBOX:
+        test.title = "Get_CBox";
+        test.bench = test_get_cbox;
+        benchmark( face, &test, max_iter, max_time );
+
+        test.title = "Get_CBox (batched)";
+        test.bench = test_get_cbox_batched;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_GET_BBOX:
+        test.title = "Get_BBox";
+        test.bench = test_get_bbox;
+        benchmark( face, &test, max_iter, max_time );
+
+        test.title = "Get_BBox (batched)";
+        test.bench = test_get_bbox_batched;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_CMAP:
+        {
+          bcharset_t  charset;
+
+
+          get_charset( face, &charset );
+          if ( charset.code )
+          {
+            test.user_data = (void*)&charset;
+
+
+            test.title = "Get_Char_Index";
+            test.bench = test_get_char_index;
+
+            benchmark( face, &test, max_iter, max_time );
+
+            if ( compare_cached )
+            {
+              test.cache_first = 1;
+
+              test.title = "Get_Char_Index (cached)";
+              test.bench = test_cmap_cache;
+              benchmark( face, &test, max_iter, max_time );
+            }
+
+            free( charset.code );
+          }
+        }
+        break;
+
+      case FT_BENCH_CMAP_ITER:
+        test.title = "Iterate CMap";
+        test.bench = test_cmap_iter;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_NEW_FACE:
+        test.title = "New_Face";
+        test.bench = test_new_face;
+        benchmark( face, &test, max_iter, max_time );
+
+        if ( use_streams )
+          run_io_profile();
+        break;
+
+      case FT_BENCH_EMBOLDEN:
+        test.title = "Embolden";
+        test.bench = test_embolden;
+        if ( face_size )
+          benchmark( face, &test, max_iter, max_time );
+        else
+          report_skip( test.title, "disabled (size = 0)" );
+        break;
+
+      case FT_BENCH_STROKE:
+        test.title = "Stroke";
+        test.bench = test_stroke;
+        if ( face_size )
+          benchmark( face, &test, max_iter, max_time );
+        else
+          report_skip( test.title, "disabled (size = 0)" );
+        break;
+
+      case FT_BENCH_NEW_FACE_AND_LOAD_GLYPH:
+        test.title = "New_Face & load glyph(s)";
+        test.bench = test_new_face_and_load_glyph;
+        benchmark( face, &test, max_iter, max_time );
+        break;
+
+      case FT_BENCH_TEXT:
+        /* only run by default if a corpus is given */
+        if ( !text.code )
+        {
+          if ( test_string )
+            report_skip( "Text", "no text corpus (option `-u')" );
+          break;
+        }
+
+        test.user_data   = (void*)&text;
+        test.cache_first = 1;
+
+        test.title = "Text (sbit cached)";
+        test.bench = test_text_sbit_cache;
+        if ( face_size )
+          benchmark( face, &test, max_iter, max_time );
+        else
+          report_skip( test.title, "disabled (size = 0)" );
+
+        test.title = "Text (image cached)";
+        test.bench = test_text_image_cache;
+        if ( face_size )
+          benchmark( face, &test, max_iter, max_time );
+        else
+          report_skip( test.title, "disabled (size = 0)" );
+        break;
+
+      case FT_BENCH_VARIATION:
+        {
+          static const char*  titles[2][3] =
+          {
+            { "Var_Switch",
+              "Var_Load",
+              "Var_Advances" },
+            { "Var_Switch (no HVAR)",
+              "Var_Load (no HVAR)",
+              "Var_Advances (no HVAR)" }
+          };
+
+          bvar_t       var;
+          const char*  status;
+          FT_Face      bench_face = face;
+          FT_Byte*     data       = NULL;
+          size_t       size       = 0;
+          int          k, l;
+
+
+          status = get_var_instances( face, &var );
+          if ( status )
+          {
+            /* only complain about fonts without axes if asked to */
+            if ( var.saved || test_string )
+              report_skip( "Var_Switch", status );
+            free_var_instances( &var );
+            break;
+          }
+
+          test.user_data = (void*)&var;
+          test.bench     = test_var;
+
+          /* the same tests with a copy of the font that lacks */
+          /* metrics variations, if it has any                 */
+          for ( l = 0; l < 2; l++ )
+          {
+            if ( l == 1 )
+            {
+              if ( num_threads > 1 )
+                status = "not available with option `-j'";
+              else
+              {
+                FT_Error  error = get_face_without_hvar( &bench_face,
+                                                         &data,
+                                                         &size );
+
+
+                if ( error == FT_Err_Table_Missing )
+                  status = "no HVAR or VVAR table";
+                else if ( error )
+                  status = "couldn't open font copy";
+              }
+            }
+
+            for ( k = 0; k < 3; k++ )
+            {
+              test.title = titles[l][k];
+              var.timed  = k;
+
+              if ( status )
+                report_skip( test.title, status );
+              else
+                benchmark( bench_face, &test, max_iter, max_time );
+            }
+
+            if ( l == 0 )
+              FT_Set_Var_Design_Coordinates( face, var.num_axes, var.saved );
+          }
+
+          if ( bench_face != face )
+            FT_Done_Face( bench_face );
+          unload_font_data( PRELOAD_READ, data, size );
+          free_var_instances( &var );
+        }
+        break;
+
+      case FT_BENCH_COLOR:
+        {
+          FT_Int    strike = get_color_strike( face );
+          FT_ULong  length = 0;
+          int       has_layers;
+
+
+          has_layers = FT_HAS_COLOR( face )                             &&
+                       !FT_Load_Sfnt_Table( face, TTAG_COLR, 0,
+                                            NULL, &length );
+
+          if ( strike < 0 && !has_layers )
+          {
+            if ( test_string )
+              report_skip( "Color_Load", "no color glyphs" );
+            break;
+          }
+
+          if ( !face_size )
+          {
+            report_skip( "Color_Load", "disabled (size = 0)" );
+            break;
+          }
+
+          test.user_data = (void*)&strike;
+
+          test.title = "Color_Load";
+          test.bench = test_color_load;
+          benchmark( face, &test, max_iter, max_time );
+
+          test.title = "Color_Downscale";
+          test.bench = test_color_downscale;
+          if ( strike < 0 )
+            report_skip( test.title, "no color bitmaps" );
+          else if ( face->available_sizes[strike].y_ppem <=
+                      (FT_Pos)requested_size * 64            )
+            report_skip( test.title, "no strike larger than face size" );
+          else
+            benchmark( face, &test, max_iter, max_time );
+
+          test.title = "Color_Layers";
+          test.bench = test_color_layers;
+          if ( has_layers )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title, "no COLR table" );
+        }
+        break;
+
+      case FT_BENCH_SDF:
+        {
+          int  from_bitmap, k, l;
+
+
+          if ( !face_size || !FT_IS_SCALABLE( face ) )
+          {
+            report_skip( "SDF", face_size ? "no outlines"
+                                          : "disabled (size = 0)" );
+            break;
+          }
+
+          test.user_data = (void*)&from_bitmap;
+          test.bench     = test_sdf;
+
+          for ( from_bitmap = 0; from_bitmap < 2; from_bitmap++ )
+          {
+            for ( k = 0; k < ( num_sdf_sizes ? num_sdf_sizes : 1 ); k++ )
+            {
+              double  size = num_sdf_sizes ? sdf_sizes[k] : face_size;
+              char    title[64];
+
+
+              /* also used by the worker threads of option `-j' */
+              char_size = (FT_F26Dot6)( size * 64 + 0.5 );
+              if ( set_face_size( face ) )
+              {
+                snprintf( title, sizeof ( title ), "%s (%gpx)",
+                          from_bitmap ? "BSDF" : "SDF", size );
+                report_skip( title, "couldn't set size" );
+                continue;
+              }
+
+              for ( l = 0; l < num_sdf_spreads; l++ )
+              {
+                snprintf( title, sizeof ( title ), "%s (%gpx, spread %d)",
+                          from_bitmap ? "BSDF" : "SDF",
+                          size,
+                          sdf_spreads[l] );
+                test.title = title;
+
+                sdf_spread = sdf_spreads[l];
+                set_library_properties( lib );
+
+                benchmark( face, &test, max_iter, max_time );
+              }
+            }
+          }
+
+          char_size = 0;
+          set_face_size( face );
+        }
+        break;
+
+      case FT_BENCH_OUTLINE:
+        {
+          static const char*  titles[] =
+          {
+            "Outline_Decompose",
+            "Outline_Transform",
+            "Outline_Translate",
+            "Outline_Get_Orientation"
+          };
+
+          boutline_t  op;
+          char        title[64];
+          int         k;
+
+
+          if ( !FT_IS_SCALABLE( face ) )
+          {
+            report_skip( "Outline_Decompose", "no outlines" );
+            break;
+          }
+
+          test.user_data = (void*)&op;
+          test.bench     = test_outline;
+
+          for ( op.op = OUTLINE_DECOMPOSE;
+                op.op < OUTLINE_EMBOLDEN;
+                op.op++ )
+          {
+            test.title = titles[op.op];
+            benchmark( face, &test, max_iter, max_time );
+          }
+
+          op.op = OUTLINE_EMBOLDEN;
+          for ( k = 0; k < N_EMBOLDEN_STRENGTHS; k++ )
+          {
+            snprintf( title, sizeof ( title ), "Outline_Embolden (%gpx)",
+                      embolden_strengths[k] );
+            test.title  = title;
+            op.strength = (FT_Pos)( embolden_strengths[k] * 64 + 0.5 );
+            benchmark( face, &test, max_iter, max_time );
+          }
+
+          test.title     = "Outline_Get_Bitmap";
+          test.bench     = test_outline_get_bitmap;
+          test.user_data = NULL;
+          if ( face_size )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title, "disabled (size = 0)" );
+        }
+        break;
+
+      case FT_BENCH_LAYOUT:
+        {
+          bcharset_t  glyphs;
+          blayout_t   layout;
+          FT_Fixed    kerning;
+          int         k;
+
+
+          /* the text of option `-u', or all characters of the font */
+          glyphs.size = 0;
+          glyphs.code = NULL;
+          if ( text.code )
+          {
+            glyphs.code = (FT_ULong*)calloc( (size_t)text.size + 1,
+                                             sizeof ( FT_ULong ) );
+            if ( glyphs.code )
+              glyphs.size = text.size;
+          }
+          else
+            get_charset( face, &glyphs );
+
+          if ( !glyphs.code || glyphs.size < 2 )
+          {
+            report_skip( "Layout_Advances", "no text" );
+            free( glyphs.code );
+            break;
+          }
+
+          for ( k = 0; k < glyphs.size; k++ )
+            glyphs.code[k] = FT_Get_Char_Index( face,
+                                                text.code ? text.code[k]
+                                                          : glyphs.code[k] );
+
+          layout.glyphs     = &glyphs;
+          layout.point_size = (FT_Fixed)face_size << 16;
+          layout.advances   = (FT_Fixed*)malloc( (size_t)glyphs.size *
+                                                 sizeof ( FT_Fixed ) );
+          layout.metrics    = (blayoutglyph_t*)malloc(
+                                (size_t)glyphs.size *
+                                sizeof ( blayoutglyph_t ) );
+          test.user_data    = (void*)&layout;
+
+          if ( !layout.advances || !layout.metrics )
+          {
+            report_skip( "Layout_Advances", "out of memory" );
+            free( layout.advances );
+            free( layout.metrics );
+            free( glyphs.code );
+            break;
+          }
+
+          test.title   = "Layout_Advances";
+          test.bench   = test_layout_advances;
+          layout.flags = load_flags;
+          benchmark( face, &test, max_iter, max_time );
+
+          /* the fast path refuses advances that need hinting */
+          test.title   = "Layout_Advances (fast)";
+          layout.flags = load_flags | FT_ADVANCE_FLAG_FAST_ONLY;
+          if ( FT_Get_Advances( face, (FT_UInt)glyphs.code[0], 1,
+                                layout.flags, layout.advances ) !=
+                 FT_Err_Unimplemented_Feature                      )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title,
+                         load_flags & ( FT_LOAD_NO_HINTING |
+                                        FT_LOAD_NO_SCALE   )
+                           ? "not supported by the font driver"
+                           : "not available with hinting" );
+
+          test.title = "Layout_Kerning";
+          test.bench = test_layout_kerning;
+          if ( FT_HAS_KERNING( face ) )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title, "no kerning table" );
+
+          test.title = "Layout_Track_Kerning";
+          test.bench = test_layout_track_kerning;
+          if ( !FT_Get_Track_Kerning( face, layout.point_size, -1,
+                                      &kerning ) )
+            benchmark( face, &test, max_iter, max_time );
+          else
+            report_skip( test.title, "no track kerning" );
+
+          test.title = "Layout_String";
+          test.bench = test_layout_string;
+          load_layout_metrics( face, &layout );
+          benchmark( face, &test, max_iter, max_time );
+
+          free( layout.advances );
+          free( layout.metrics );
+          free( glyphs.code );
+        }
+        break;
+
+      case FT_BENCH_FIRST_GLYPH:
+        {
+          static const char*  titles[] =
+          {
+            "1st: Init_FreeType",
+            "1st: New_Face",
+            "1st: Set_Char_Size",
+            "1st: Load_Glyph",
+            "1st: Render_Glyph",
+            "1st: total",
+            "2nd: Load_Glyph"
+          };
+
+          bfirst_t  first;
+
+
+          if ( !face_size )
+          {
+            report_skip( "1st: Init_FreeType", "disabled (size = 0)" );
+            break;
+          }
+
+          /* a typical first glyph */
+          first.gindex = FT_Get_Char_Index( face, 'A' );
+          if ( !first.gindex )
+            first.gindex = first_index;
+          first.flags    = load_flags;
+          test.user_data = (void*)&first;
+          test.bench     = test_first_glyph;
+
+          for ( first.phase = FIRST_INIT;
+                first.phase <= FIRST_LOAD_AGAIN;
+                first.phase++ )
+          {
+            test.title = titles[first.phase];
+            benchmark( face, &test, max_iter, max_time );
+          }
+
+          /* the same with the auto-hinter, whose global metrics */
+          /* get computed by the first call                      */
+          if ( !FT_IS_SCALABLE( face )                             ||
+               ( load_flags & ( FT_LOAD_NO_HINTING       |
+                                FT_LOAD_FORCE_AUTOHINT   ) ) )
+            break;
+
+          first.flags = load_flags | FT_LOAD_FORCE_AUTOHINT;
+
+          test.title  = "1st: Load_Glyph (AH)";
+          first.phase = FIRST_LOAD;
+          benchmark( face, &test, max_iter, max_time );
+
+          test.title  = "2nd: Load_Glyph (AH)";
+          first.phase = FIRST_LOAD_AGAIN;
+          benchmark( face, &test, max_iter, max_time );
+        }
+        break;
+
+      case FT_BENCH_SIZES:
+        {
+          FTC_Manager  saved_man = cache_man;
+          bchurn_t     churn;
+
+
+          if ( !face_size || !FT_IS_SCALABLE( face ) )
+          {
+            report_skip( "Sizes: New_Size",
+                         face_size ? "not scalable"
+                                   : "disabled (size = 0)" );
+            break;
+          }
+
+          churn_init( &churn, face );
+          test.user_data = (void*)&churn;
+
+          test.title = "Sizes: New_Size";
+          test.bench = test_new_size;
+          benchmark( face, &test, max_iter, max_time );
+
+          test.title = "Sizes: Activate_Size";
+          test.bench = test_activate_size;
+          benchmark( face, &test, max_iter, max_time );
+
+          test.title = "Sizes: Set_Char_Size";
+          test.bench = test_set_char_size;
+          benchmark( face, &test, max_iter, max_time );
+
+          /* first with the default number of cached sizes; as we */
+          /* cycle through more sizes than that, every lookup is a */
+          /* miss -- this is the cost of an evicting size cache    */
+          test.title       = "Sizes: LookupSize (miss)";
+          test.bench       = test_lookup_size;
+          test.cache_first = 1;
+          test.lookup_unit = "sizes";
+          benchmark( face, &test, max_iter, max_time );
+
+          /* then with a cache manager that holds all sizes (and the */
+          /* one of the cached tests); worker threads of option `-j' */
+          /* use `max_sizes', too                                    */
+          test.title = "Sizes: LookupSize (all)";
+
+          max_sizes = N_CHURN_SIZES + 1;
+          cache_man = NULL;
+          if ( saved_man                                            &&
+               !FTC_Manager_New( lib,
+                                 0,
+                                 max_sizes,
+                                 max_bytes,
+                                 churn_face_requester,
+                                 NULL,
+                                 &cache_man )                       )
+          {
+            benchmark( face, &test, max_iter, max_time );
+            FTC_Manager_Done( cache_man );
+          }
+          else
+            report_skip( test.title, "no cache manager" );
+
+          cache_man = saved_man;
+          max_sizes = 0;
+        }
+        break;
+      }
+    }
+  }
+
+
+  /*
+   * Cache-size sweep (option `-M'): run the cached lookups of tests `a'
+   * and `e' with every cache size and with several access patterns.
+   */
+
+  enum {
+    SWEEP_SEQUENTIAL,
+    SWEEP_RANDOM,
+    SWEEP_ZIPF,
+    SWEEP_TEXT,
+    N_SWEEP_PATTERNS
+  };
+
+  static const char*  sweep_pattern_names[N_SWEEP_PATTERNS] =
+  {
+    "seq",
+    "random",
+    "zipf",
+    "text"
+  };
+
+
+  /*
+   * Fill `pattern' with `source->size' elements of `source': all of them
+   * in order, uniformly distributed random ones, or random ones with a
+   * Zipf distribution (the probability of the k-th element being
+   * proportional to 1/k).
+   */
+  static void
+  make_pattern( int          kind,
+                bcharset_t*  source,
+                bcharset_t*  pattern )
+  {
+    FT_UInt32  state = 2463534242UL;
+    double*    cumul = NULL;
+    int        n     = source->size;
+    int        i;
+
+
+    pattern->size = 0;
+    pattern->code = NULL;
+
+    if ( n <= 0 )
+      return;
+
+    pattern->code = (FT_ULong*)malloc( (size_t)n * sizeof ( FT_ULong ) );
+    if ( !pattern->code )
+      return;
+
+    if ( kind == SWEEP_ZIPF )
+    {
+      cumul = (double*)malloc( (size_t)n * sizeof ( double ) );
+      if ( !cumul )
+      {
+        free( pattern->code );
+        pattern->code = NULL;
+
+        return;
+      }
+
+      for ( i = 0; i < n; i++ )
+        cumul[i] = ( i ? cumul[i - 1] : 0 ) + 1.0 / ( i + 1 );
+    }
+
+    for ( i = 0; i < n; i++ )
+    {
+      int  k;
+
+
+      if ( kind == SWEEP_RANDOM )
+        k = (int)( next_random( &state ) % (FT_UInt32)n );
+      else if ( kind == SWEEP_ZIPF )
+      {
+        double  u   = next_random( &state ) / 4294967296.0 * cumul[n - 1];
+        int     min = 0;
+        int     max = n - 1;
+
+
+        /* find the first element with `cumul[k] > u' */
+        while ( min < max )
+        {
+          int  mid = ( min + max ) / 2;
+
+
+          if ( cumul[mid] > u )
+            max = mid;
+          else
+            min = mid + 1;
+        }
+        k = min;
+      }
+      else
+        k = i;
+
+      pattern->code[i] = source->code[k];
+    }
+
+    pattern->size = n;
+
+    free( cumul );
+  }
+
+
+  /*
+   * The face requester of the sweep mode's cache managers; since they get
+   * destroyed after each test, they must not discard our face.
+   */
+  static FT_Error
+  sweep_face_requester( FTC_FaceID  face_id,
+                        FT_Library  library,
+                        FT_Pointer  request_data,
+                        FT_Face*    aface )
+  {
+    FT_UNUSED( face_id );
+    FT_UNUSED( library );
+
+    *aface = (FT_Face)request_data;
+
+    return FT_Reference_Face( *aface );
+  }
+
+
+  static void
+  run_sweep( FT_Face  face,
+             int      max_iter,
+             double   max_time )
+  {
+    static const char*  cache_names[3] = { "Image", "SBit", "CMap" };
+
+    FTC_Manager     saved_man   = cache_man;
+    FTC_CMapCache   saved_cmap  = cmap_cache;
+    FTC_ImageCache  saved_image = image_cache;
+    FTC_SBitCache   saved_sbit  = sbit_cache;
+    unsigned long   saved_bytes = max_bytes;
+
+    bcharset_t  all_glyphs, charset;
+    bcharset_t  glyphs[N_SWEEP_PATTERNS], codes[N_SWEEP_PATTERNS];
+    int         c, p, s, n;
+
+
+    /* the glyph indices of option `-i' and their character codes */
+    all_glyphs.size = 0;
+    all_glyphs.code = (FT_ULong*)calloc( (size_t)face->num_glyphs + 1,
+                                         sizeof ( FT_ULong ) );
+    if ( all_glyphs.code )
+    {
+      unsigned int  i;
+
+
+      FOREACH( i )
+        all_glyphs.code[all_glyphs.size++] = i;
+    }
+
+    get_charset( face, &charset );
+
+    for ( p = 0; p < SWEEP_TEXT; p++ )
+    {
+      make_pattern( p, &all_glyphs, &glyphs[p] );
+      make_pattern( p, &charset, &codes[p] );
+    }
+
+    /* the text corpus of option `-u', as glyph indices, too */
+    make_pattern( SWEEP_SEQUENTIAL, &text, &codes[SWEEP_TEXT] );
+    make_pattern( SWEEP_SEQUENTIAL, &text, &glyphs[SWEEP_TEXT] );
+    for ( n = 0; n < glyphs[SWEEP_TEXT].size; n++ )
+      glyphs[SWEEP_TEXT].code[n] = FT_Get_Char_Index( face, text.code[n] );
+
+    for ( c = 0; c < 3; c++ )
+    {
+      btest_t  test;
+
+
+      if ( !TEST( c < 2 ? 'a' : 'e' ) )
+        continue;
+
+      test.bench       = c == 0 ? test_image_cache_list
+                       : c == 1 ? test_sbit_cache_list
+                                : test_cmap_cache;
+      test.cache_first = 1;
+      test.lookup_unit = NULL;
+
+      for ( p = 0; p < N_SWEEP_PATTERNS; p++ )
+      {
+        test.user_data = c < 2 ? (void*)&glyphs[p] : (void*)&codes[p];
+
+        if ( !( (bcharset_t*)test.user_data )->size )
+          continue;
+
+        for ( s = 0; s < num_sweep_sizes; s++ )
+        {
+          char  title[64];
+
+
+          snprintf( title, sizeof ( title ), "%s (%s, %lu KiB)",
+                    cache_names[c],
+                    sweep_pattern_names[p],
+                    sweep_sizes[s] );
+          test.title = title;
+
+          if ( c == 1 && !face_size )
+          {
+            report_skip( test.title, "disabled (size = 0)" );
+            continue;
+          }
+
+          /* worker threads of option `-j' use `max_bytes', too */
+          max_bytes   = sweep_sizes[s] * 1024;
+          cache_man   = NULL;
+          cmap_cache  = NULL;
+          image_cache = NULL;
+          sbit_cache  = NULL;
+
+          if ( FTC_Manager_New( lib,
+                                0,
+                                0,
+                                max_bytes,
+                                sweep_face_requester,
+                                face,
+                                &cache_man ) )
+          {
+            report_skip( test.title, "couldn't create cache manager" );
+            continue;
+          }
+
+          benchmark( face, &test, max_iter, max_time );
+
+          FTC_Manager_Done( cache_man );
+        }
+      }
+    }
+
+    cache_man   = saved_man;
+    cmap_cache  = saved_cmap;
+    image_cache = saved_image;
+    sbit_cache  = saved_sbit;
+    max_bytes   = saved_bytes;
+
+    for ( p = 0; p < N_SWEEP_PATTERNS; p++ )
+    {
+      free( glyphs[p].code );
+      free( codes[p].code );
+    }
+    free( all_glyphs.code );
+    free( charset.code );
+  }
+
+
+  /*
+   * Face-size sweep (option `-Z'): run tests `a', `c', and `i' for every
+   * size, and report the time and the allocated bytes per operation as
+   * a function of the size.
+   */
+
+#define N_PPEM_TESTS  3
+
+  static const char   ppem_test_letters[N_PPEM_TESTS] = { 'a', 'c', 'i' };
+  static const char*  ppem_test_titles[N_PPEM_TESTS]  =
+  {
+    "Load",
+    "Render",
+    "Stroke"
+  };
+
+
+  static void
+  report_ppem( double    ppem,
+               bfont_t*  font )
+  {
+    int  i, j;
+
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      for ( i = 0; i < font->num_results; i++ )
+      {
+        bfontresult_t*  r = &font->results[i];
+
+
+        printf( "%s    { \"test\": ", num_results++ ? ",\n" : "" );
+        print_string( r->title );
+        printf( ", \"ppem\": %g, \"status\": ", ppem );
+        print_string( r->done ? "ok" : "no error-free calls" );
+        if ( r->done )
+          printf( ", \"done\": %d, \"us_per_op\": %.6g,"
+                  " \"bytes_per_op\": %.6g",
+                  r->done, r->time / r->done, r->bytes / r->done );
+        printf( " }" );
+      }
+      break;
+
+    case FORMAT_CSV:
+      for ( i = 0; i < font->num_results; i++ )
+      {
+        bfontresult_t*  r = &font->results[i];
+
+
+        print_csv_settings( filename, info.family, info.style );
+        print_string( r->title );
+        printf( ",%g,", ppem );
+        print_string( r->done ? "ok" : "no error-free calls" );
+        printf( ",%d,", r->done );
+        if ( r->done )
+          printf( "%.6g,%.6g", r->time / r->done, r->bytes / r->done );
+        else
+          putchar( ',' );
+        putchar( '\n' );
+      }
+      break;
+
+    default:
+      printf( "  %8g", ppem );
+
+      for ( i = 0; i < N_PPEM_TESTS; i++ )
+      {
+        if ( !TEST( ppem_test_letters[i] ) )
+          continue;
+
+        for ( j = 0; j < font->num_results; j++ )
+          if ( !strcmp( font->results[j].title, ppem_test_titles[i] ) )
+            break;
+
+        if ( j < font->num_results && font->results[j].done )
+          printf( " %9.3f %9.0f",
+                  font->results[j].time / font->results[j].done,
+                  font->results[j].bytes / font->results[j].done );
+        else
+          printf( " %9s %9s", "-", "-" );
+      }
+
+      if ( font->status )
+        printf( "  %s", font->status );
+      printf( "\n" );
+    }
+  }
+
+
+  static void
+  run_ppem_sweep( FT_Face  face,
+                  int      max_iter,
+                  double   max_time )
+  {
+    bfont_t*  fonts;
+    btest_t   test;
+    int       i, k;
+
+
+    if ( !FT_IS_SCALABLE( face ) )
+    {
+      fprintf( stderr, "face size sweep needs a scalable font\n" );
+
+      return;
+    }
+
+    fonts = (bfont_t*)calloc( (size_t)num_ppem_sizes, sizeof ( bfont_t ) );
+    if ( !fonts )
+    {
+      fprintf( stderr, "couldn't allocate results\n" );
+
+      return;
+    }
+
+    if ( output_format == FORMAT_TEXT )
+    {
+      printf( "face size sweep (us/op and allocated bytes/op):\n"
+              "\n"
+              "      ppem" );
+      for ( i = 0; i < N_PPEM_TESTS; i++ )
+        if ( TEST( ppem_test_letters[i] ) )
+          printf( " %9s %9s", ppem_test_titles[i], "bytes" );
+      printf( "\n" );
+    }
+
+    test.cache_first = 0;
+    test.user_data   = NULL;
+    test.lookup_unit = NULL;
+
+    for ( k = 0; k < num_ppem_sizes; k++ )
+    {
+      current_font = &fonts[k];
+
+      char_size = (FT_F26Dot6)( ppem_sizes[k] * 64 + 0.5 );
+      if ( set_face_size( face ) )
+        fonts[k].status = "couldn't set size";
+      else
+      {
+        for ( i = 0; i < N_PPEM_TESTS; i++ )
+        {
+          if ( !TEST( ppem_test_letters[i] ) )
+            continue;
+
+          test.title = ppem_test_titles[i];
+          test.bench = i == 0 ? test_load
+                     : i == 1 ? test_render
+                              : test_stroke;
+          benchmark( face, &test, max_iter, max_time );
+        }
+      }
+
+      current_font = NULL;
+
+      report_ppem( ppem_sizes[k], &fonts[k] );
+      fflush( stdout );
+    }
+
+    char_size = 0;
+    set_face_size( face );
+
+    for ( k = 0; k < num_ppem_sizes; k++ )
+      free_font_results( &fonts[k] );
+    free( fonts );
+  }
+
+
+#ifdef FTBENCH_AB
+
+  /*
+   * A/B mode (option `-y'): load two builds of FreeType, resolve the
+   * functions needed by the basic tests from each, and run every test in
+   * short slices alternating between the builds in the order ABBA, so
+   * that drift (of the CPU frequency or the load of other processes)
+   * affects both builds alike.  The speedup of build B is the geometric
+   * mean of the ratios of the times per operation of A and B in paired
+   * slices.
+   */
+
+#define AB_SLICE_TIME  0.02  /* in seconds */
+#define AB_MIN_PAIRS   5
+#define AB_MAX_PAIRS   2048
+
+
+  /* the functions used by the tests, resolved from one library */
+  typedef struct  bftapi_t_ {
+    void*       handle;
+    FT_Library  library;
+    FT_Face     face;
+
+    FT_Error  (*Init_FreeType)( FT_Library* );
+    FT_Error  (*Done_FreeType)( FT_Library );
+    void      (*Library_Version)( FT_Library, FT_Int*, FT_Int*, FT_Int* );
+    FT_Error  (*Property_Set)( FT_Library, const FT_String*,
+                               const FT_String*, const void* );
+    FT_Error  (*Library_SetLcdFilter)( FT_Library, FT_LcdFilter );
+
+    FT_Error  (*New_Face)( FT_Library, const char*, FT_Long, FT_Face* );
+    FT_Error  (*Done_Face)( FT_Face );
+    FT_Error  (*Set_Char_Size)( FT_Face, FT_F26Dot6, FT_F26Dot6,
+                                FT_UInt, FT_UInt );
+    FT_Error  (*Set_Pixel_Sizes)( FT_Face, FT_UInt, FT_UInt );
+    FT_Error  (*Select_Size)( FT_Face, FT_Int );
+
+    FT_Error  (*Load_Glyph)( FT_Face, FT_UInt, FT_Int32 );
+    FT_Error  (*Get_Advances)( FT_Face, FT_UInt, FT_UInt, FT_Int32,
+                               FT_Fixed* );
+    FT_Error  (*Render_Glyph)( FT_GlyphSlot, FT_Render_Mode );
+    FT_Error  (*Get_Glyph)( FT_GlyphSlot, FT_Glyph* );
+    void      (*Done_Glyph)( FT_Glyph );
+    void      (*Glyph_Get_CBox)( FT_Glyph, FT_UInt, FT_BBox* );
+    FT_UInt   (*Get_Char_Index)( FT_Face, FT_ULong );
+    FT_ULong  (*Get_First_Char)( FT_Face, FT_UInt* );
+    FT_ULong  (*Get_Next_Char)( FT_Face, FT_ULong, FT_UInt* );
+    void      (*GlyphSlot_Embolden)( FT_GlyphSlot );
+    FT_Error  (*Stroker_New)( FT_Library, FT_Stroker* );
+    void      (*Stroker_Set)( FT_Stroker, FT_Fixed, FT_Stroker_LineCap,
+                              FT_Stroker_LineJoin, FT_Fixed );
+    void      (*Stroker_Done)( FT_Stroker );
+    FT_Error  (*Glyph_Stroke)( FT_Glyph*, FT_Stroker, FT_Bool );
+    void      (*Outline_Transform)( const FT_Outline*, const FT_Matrix* );
+    FT_Error  (*Outline_Get_BBox)( FT_Outline*, FT_BBox* );
+
+  } bftapi_t;
+
+
+  typedef struct  bftfunc_t_ {
+    const char*  name;
+    size_t       offset;
+
+  } bftfunc_t;
+
+#define AB_FUNC( name )  { "FT_" #name, offsetof( bftapi_t, name ) }
+
+  static const bftfunc_t  ab_funcs[] =
+  {
+    AB_FUNC( Init_FreeType ),
+    AB_FUNC( Done_FreeType ),
+    AB_FUNC( Library_Version ),
+    AB_FUNC( Property_Set ),
+    AB_FUNC( Library_SetLcdFilter ),
+    AB_FUNC( New_Face ),
+    AB_FUNC( Done_Face ),
+    AB_FUNC( Set_Char_Size ),
+    AB_FUNC( Set_Pixel_Sizes ),
+    AB_FUNC( Select_Size ),
+    AB_FUNC( Load_Glyph ),
+    AB_FUNC( Get_Advances ),
+    AB_FUNC( Render_Glyph ),
+    AB_FUNC( Get_Glyph ),
+    AB_FUNC( Done_Glyph ),
+    AB_FUNC( Glyph_Get_CBox ),
+    AB_FUNC( Get_Char_Index ),
+    AB_FUNC( Get_First_Char ),
+    AB_FUNC( Get_Next_Char ),
+    AB_FUNC( GlyphSlot_Embolden ),
+    AB_FUNC( Stroker_New ),
+    AB_FUNC( Stroker_Set ),
+    AB_FUNC( Stroker_Done ),
+    AB_FUNC( Glyph_Stroke ),
+    AB_FUNC( Outline_Transform ),
+    AB_FUNC( Outline_Get_BBox )
+  };
+
+  static bftapi_t  ab_apis[2];
+
+
+  static void
+  ab_close( bftapi_t*  api )
+  {
+    if ( api->face )
+      api->Done_Face( api->face );
+    if ( api->library )
+      api->Done_FreeType( api->library );
+    if ( api->handle )
+      dlclose( api->handle );
+
+    memset( api, 0, sizeof ( *api ) );
+  }
+
+
+  /* load library `k', set it up like `lib', and open the font */
+  static int
+  ab_open( int  k )
+  {
+    bftapi_t*    api  = &ab_apis[k];
+    const char*  path = ab_libs[k];
+    FT_Int       major, minor, patch;
+    FT_Error     error;
+    size_t       i;
+
+
+#ifdef LM_ID_NEWLM
+    /* a separate namespace keeps the libraries (and their dependencies) */
+    /* apart, even if both paths refer to the same file                  */
+    api->handle = dlmopen( LM_ID_NEWLM, path, RTLD_NOW | RTLD_LOCAL );
+#elif defined RTLD_DEEPBIND
+    api->handle = dlopen( path, RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND );
+#else
+    api->handle = dlopen( path, RTLD_NOW | RTLD_LOCAL );
+#endif
+    if ( !api->handle )
+    {
+      fprintf( stderr, "couldn't load `%s': %s\n", path, dlerror() );
+
+      return -1;
+    }
+
+    for ( i = 0; i < sizeof ( ab_funcs ) / sizeof ( ab_funcs[0] ); i++ )
+    {
+      void*  sym = dlsym( api->handle, ab_funcs[i].name );
+
+
+      if ( !sym )
+      {
+        fprintf( stderr, "`%s' doesn't provide `%s'\n",
+                 path, ab_funcs[i].name );
+        ab_close( api );
+
+        return -1;
+      }
+
+      *(void**)( (char*)api + ab_funcs[i].offset ) = sym;
+    }
+
+    if ( api->Init_FreeType( &api->library ) )
+    {
+      fprintf( stderr, "couldn't initialize `%s'\n", path );
+      api->library = NULL;
+      ab_close( api );
+
+      return -1;
+    }
+
+    api->Library_Version( api->library, &major, &minor, &patch );
+    snprintf( ab_versions[k], sizeof ( ab_versions[k] ),
+              "%d.%d.%d", major, minor, patch );
+
+    /* the same as `set_library_properties' */
+    if ( tt_interpreter_version >= 0 )
+      api->Property_Set( api->library,
+                         "truetype",
+                         "interpreter-version", &tt_interpreter_version );
+    if ( ps_hinting_engine >= 0 )
+    {
+      api->Property_Set( api->library,
+                         "cff",
+                         "hinting-engine", &ps_hinting_engine );
+      api->Property_Set( api->library,
+                         "type1",
+                         "hinting-engine", &ps_hinting_engine );
+      api->Property_Set( api->library,
+                         "t1cid",
+                         "hinting-engine", &ps_hinting_engine );
+    }
+    if ( lcd_filter_set )
+      api->Library_SetLcdFilter( api->library, lcd_filter );
+
+    if ( api->New_Face( api->library, filename, face_index, &api->face ) )
+    {
+      fprintf( stderr, "couldn't open `%s' with `%s'\n", filename, path );
+      api->face = NULL;
+      ab_close( api );
+
+      return -1;
+    }
+
+    /* the same as `set_face_size' */
+    if ( FT_IS_SCALABLE( api->face ) && char_size )
+      error = api->Set_Char_Size( api->face, char_size, char_size, 72, 72 );
+    else if ( FT_IS_SCALABLE( api->face ) )
+      error = api->Set_Pixel_Sizes( api->face, face_size, face_size );
+    else
+      error = api->Select_Size( api->face, 0 );
+    if ( error )
+    {
+      fprintf( stderr, "couldn't set the face size with `%s'\n", path );
+      ab_close( api );
+
+      return -1;
+    }
+
+    return 0;
+  }
+
+
+  /*
+   * The tests of the A/B mode, which do the same as the corresponding
+   * tests of the normal mode.
+   */
+
+  static int
+  ab_test_load( btimer_t*  timer,
+                bftapi_t*  api,
+                void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      TIMER_START( timer );
+      if ( !api->Load_Glyph( api->face, i, load_flags ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  ab_test_load_advances( btimer_t*  timer,
+                         bftapi_t*  api,
+                         void*      user_data )
+  {
+    FT_Fixed*  advances;
+    FT_ULong   flags = *((FT_ULong*)user_data);
+    FT_UInt    start, count;
+
+
+    if ( incr_index > 0 )
+    {
+      start = first_index;
+      count = last_index - first_index + 1;
+    }
+    else
+    {
+      start = last_index;
+      count = first_index - last_index + 1;
+    }
+
+    advances = (FT_Fixed *)calloc( sizeof ( FT_Fixed ), (size_t)count );
+
+    TIMER_START( timer );
+    api->Get_Advances( api->face, start, count, (FT_Int32)flags, advances );
+    TIMER_STOP_N( timer, (int)count );
+
+    free( advances );
+
+    return (int)count;
+  }
+
+
+  static int
+  ab_test_render( btimer_t*  timer,
+                  bftapi_t*  api,
+                  void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      if ( !api->Render_Glyph( api->face->glyph, render_mode ) )
+        done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  ab_test_get_glyph( btimer_t*  timer,
+                     bftapi_t*  api,
+                     void*      user_data )
+  {
+    FT_Glyph      glyph;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      if ( !api->Get_Glyph( api->face->glyph, &glyph ) )
+      {
+        api->Done_Glyph( glyph );
+        done++;
+      }
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  ab_test_get_char_index( btimer_t*  timer,
+                          bftapi_t*  api,
+                          void*      user_data )
+  {
+    bcharset_t*  charset = (bcharset_t*)user_data;
+    int          i, done = 0;
+
+
+    TIMER_START( timer );
+
+    for ( i = 0; i < charset->size; i++ )
+    {
+      if ( api->Get_Char_Index( api->face, charset->code[i] ) )
+        done++;
+    }
+
+    TIMER_STOP_N( timer, done );
+
+    return done;
+  }
+
+
+  static int
+  ab_test_cmap_iter( btimer_t*  timer,
+                     bftapi_t*  api,
+                     void*      user_data )
+  {
+    FT_UInt   idx;
+    FT_ULong  charcode;
+
+    FT_UNUSED( user_data );
+
+
+    TIMER_START( timer );
+
+    charcode = api->Get_First_Char( api->face, &idx );
+    while ( idx != 0 )
+      charcode = api->Get_Next_Char( api->face, charcode, &idx );
+
+    TIMER_STOP( timer );
+
+    return 1;
+  }
+
+
+  static int
+  ab_test_new_face( btimer_t*  timer,
+                    bftapi_t*  api,
+                    void*      user_data )
+  {
+    FT_Face  bench_face;
+
+    FT_UNUSED( user_data );
+
+
+    TIMER_START( timer );
+
+    if ( !api->New_Face( api->library, filename, face_index, &bench_face ) )
+      api->Done_Face( bench_face );
+
+    TIMER_STOP( timer );
+
+    return 1;
+  }
+
+
+  static int
+  ab_test_embolden( btimer_t*  timer,
+                    bftapi_t*  api,
+                    void*      user_data )
+  {
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      TIMER_START( timer );
+      api->GlyphSlot_Embolden( api->face->glyph );
+      done++;
+      TIMER_STOP( timer );
+    }
+
+    return done;
+  }
+
+
+  static int
+  ab_test_stroke( btimer_t*  timer,
+                  bftapi_t*  api,
+                  void*      user_data )
+  {
+    FT_Glyph      glyph;
+    FT_Stroker    stroker;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    if ( api->Stroker_New( api->library, &stroker ) )
+      return 0;
+
+    api->Stroker_Set( stroker, api->face->size->metrics.y_ppem,
+                      FT_STROKER_LINECAP_ROUND,
+                      FT_STROKER_LINEJOIN_ROUND,
+                      0 );
+
+    FOREACH( i )
+    {
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      if ( api->Get_Glyph( api->face->glyph, &glyph ) )
+        continue;
+
+      TIMER_START( timer );
+      api->Glyph_Stroke( &glyph, stroker, 1 );
+      TIMER_STOP( timer );
+
+      api->Done_Glyph( glyph );
+      done++;
+    }
+
+    api->Stroker_Done( stroker );
+
+    return done;
+  }
+
+
+  static int
+  ab_test_get_bbox( btimer_t*  timer,
+                    bftapi_t*  api,
+                    void*      user_data )
+  {
+    FT_BBox       bbox;
+    unsigned int  i;
+    int           done  = 0;
+    FT_Matrix     rot30 = { 0xDDB4, -0x8000, 0x8000, 0xDDB4 };
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      FT_Outline*  outline;
+
+
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      outline = &api->face->glyph->outline;
+
+      /* rotate outline by 30 degrees */
+      api->Outline_Transform( outline, &rot30 );
+
+      TIMER_START( timer );
+      api->Outline_Get_BBox( outline, &bbox );
+      TIMER_STOP( timer );
+
+      done++;
+    }
+
+    return done;
+  }
+
+
+  static int
+  ab_test_get_cbox( btimer_t*  timer,
+                    bftapi_t*  api,
+                    void*      user_data )
+  {
+    FT_Glyph      glyph;
+    FT_BBox       bbox;
+    unsigned int  i;
+    int           done = 0;
+
+    FT_UNUSED( user_data );
+
+
+    FOREACH( i )
+    {
+      if ( api->Load_Glyph( api->face, i, load_flags ) )
+        continue;
+
+      if ( api->Get_Glyph( api->face->glyph, &glyph ) )
+        continue;
+
+      TIMER_START( timer );
+      api->Glyph_Get_CBox( glyph, FT_GLYPH_BBOX_PIXELS, &bbox );
+      TIMER_STOP( timer );
+
+      api->Done_Glyph( glyph );
+      done++;
+    }
+
+    return done;
+  }
+
+
+  typedef struct  babtest_t_ {
+    char         letter;
+    const char*  title;
+    int          (*bench)( btimer_t*  timer,
+                           bftapi_t*  api,
+                           void*      user_data );
+    void*        user_data;
+    int          need_size;  /* skipped for face size 0 */
+
+  } babtest_t;
+
+
+  static FT_ULong    ab_advance_flags[3] =
+  {
+    FT_LOAD_DEFAULT,
+    FT_LOAD_TARGET_LIGHT,
+    FT_LOAD_NO_SCALE
+  };
+  static bcharset_t  ab_charset;
+
+  static const babtest_t  ab_tests[] =
+  {
+    { 'a', "Load",                     ab_test_load,           NULL, 0 },
+    { 'b', "Load_Advances (Normal)",   ab_test_load_advances,
+      &ab_advance_flags[0], 0 },
+    { 'b', "Load_Advances (Fast)",     ab_test_load_advances,
+      &ab_advance_flags[1], 0 },
+    { 'b', "Load_Advances (Unscaled)", ab_test_load_advances,
+      &ab_advance_flags[2], 0 },
+    { 'c', "Render",                   ab_test_render,         NULL, 1 },
+    { 'd', "Get_Glyph",                ab_test_get_glyph,      NULL, 0 },
+    { 'e', "Get_Char_Index",           ab_test_get_char_index,
+      &ab_charset, 0 },
+    { 'f', "Iterate CMap",             ab_test_cmap_iter,      NULL, 0 },
+    { 'g', "New_Face",                 ab_test_new_face,       NULL, 0 },
+    { 'h', "Embolden",                 ab_test_embolden,       NULL, 1 },
+    { 'i', "Stroke",                   ab_test_stroke,         NULL, 1 },
+    { 'j', "Get_BBox",                 ab_test_get_bbox,       NULL, 0 },
+    { 'k', "Get_CBox",                 ab_test_get_cbox,       NULL, 0 }
+  };
+
+
+  typedef struct  babresult_t_ {
+    const char*  title;
+    const char*  status;    /* why the test didn't run, or NULL */
+    int          pairs;
+    int          rejected;  /* pairs rejected as outliers */
+    double       a_us;      /* median time per operation */
+    double       b_us;
+    double       speedup;   /* geometric mean of the ratios A/B   */
+    double       ci;        /* 95% conf. interval is speedup divided */
+                            /* and multiplied by 1 + ci / 100        */
+    const char*  verdict;
+
+  } babresult_t;
+
+
+  static void
+  report_ab( babresult_t*  r )
+  {
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "%s    { \"test\": ", num_results ? ",\n" : "" );
+      print_string( r->title );
+      printf( ", \"status\": " );
+      print_string( r->status ? r->status : "ok" );
+      if ( !r->status )
+      {
+        printf( ", \"pairs\": %d, \"rejected\": %d,"
+                " \"a_us_per_op\": %.6g, \"b_us_per_op\": %.6g,"
+                " \"speedup\": %.6g",
+                r->pairs, r->rejected, r->a_us, r->b_us, r->speedup );
+        if ( r->ci >= 0 )
+          printf( ", \"ci_pct\": %.4g", r->ci );
+        printf( ", \"verdict\": " );
+        print_string( r->verdict );
+      }
+      printf( " }" );
+      break;
+
+    case FORMAT_CSV:
+      print_csv_settings( filename, info.family, info.style );
+      print_string( ab_versions[0] );
+      putchar( ',' );
+      print_string( ab_versions[1] );
+      putchar( ',' );
+      print_string( r->title );
+      putchar( ',' );
+      print_string( r->status ? r->status : "ok" );
+      if ( r->status )
+        printf( ",,,,,,,\n" );
+      else
+      {
+        printf( ",%d,%d,%.6g,%.6g,%.6g,",
+                r->pairs, r->rejected, r->a_us, r->b_us, r->speedup );
+        if ( r->ci >= 0 )
+          printf( "%.4g", r->ci );
+        putchar( ',' );
+        print_string( r->verdict );
+        putchar( '\n' );
+      }
+      break;
+
+    default:
+      if ( r->status )
+        printf( "  %-25s %s\n", r->title, r->status );
+      else
+      {
+        printf( "  %-25s %10.3f %10.3f %8.3f ",
+                r->title, r->a_us, r->b_us, r->speedup );
+        if ( r->ci >= 0 )
+          printf( " +-%5.2f%%", r->ci );
+        else
+          printf( " %8s", "-" );
+        printf( "  %s%s\n",
+                r->verdict,
+                !strcmp( r->verdict, "slower" ) ? " <<<" : "" );
+      }
+    }
+
+    num_results++;
+    fflush( stdout );
+  }
+
+
+  /* run `test' with `api' for a slice; return the time per operation */
+  static double
+  ab_slice( const babtest_t*  test,
+            bftapi_t*         api )
+  {
+    btimer_t  timer;
+    double    start;
+    int       done = 0;
+
+
+    memset( &timer, 0, sizeof ( timer ) );
+
+    start = timer_clock();
+    do
+      done += test->bench( &timer, api, test->user_data );
+    while ( timer_clock() - start < 1E6 * AB_SLICE_TIME );
+
+    return done ? TIMER_GET( &timer ) / done : -1;
+  }
+
+
+  static double  ab_times[2][AB_MAX_PAIRS];
+  static double  ab_log_ratios[AB_MAX_PAIRS];
+  static int     ab_kept[AB_MAX_PAIRS];
+
+
+  /* the confidence interval of the geometric mean of the ratios, */
+  /* computed on their logarithms and converted back              */
+  static double
+  ab_confidence_interval( int  n )
+  {
+    double  h = bench_confidence_half_width( ab_log_ratios, ab_kept, n );
+
+
+    return h < 0 ? -1 : 100 * ( exp( h ) - 1 );
+  }
+
+
+  static void
+  ab_benchmark( const babtest_t*  test,
+                int               max_iter,
+                double            max_time )
+  {
+    babresult_t  result;
+    double       t[2];
+    double       start, budget, sum = 0;
+    int          i, n = 0, failed = 0;
+
+
+    memset( &result, 0, sizeof ( result ) );
+    result.title = test->title;
+
+    /* warm up both libraries */
+    if ( ab_slice( test, &ab_apis[0] ) <= 0 ||
+         ab_slice( test, &ab_apis[1] ) <= 0 )
+    {
+      result.status = "no error-free calls";
+      report_ab( &result );
+
+      return;
+    }
+
+    /* with option `-E', continue until the confidence interval of */
+    /* the speedup is narrow enough                                */
+    budget = target_ci > 0 ? max_repeat_time : max_time;
+    start  = timer_clock();
+
+    while ( n < AB_MAX_PAIRS )
+    {
+      /* every other pair starts with B: ABBA ABBA ... */
+      int  first = n & 1;
+
+
+      t[first]     = ab_slice( test, &ab_apis[first] );
+      t[1 - first] = ab_slice( test, &ab_apis[1 - first] );
+
+      /* pairs with failed slices count against the budget, too */
+      if ( t[0] <= 0 || t[1] <= 0 )
+        failed++;
+      else
+      {
+        ab_times[0][n]   = t[0];
+        ab_times[1][n]   = t[1];
+        ab_log_ratios[n] = log( t[0] / t[1] );
+        n++;
+      }
+
+      if ( max_iter && n + failed >= max_iter )
+        break;
+      if ( n < AB_MIN_PAIRS && !failed )
+        continue;
+
+      if ( target_ci > 0 && n >= AB_MIN_PAIRS )
+      {
+        bench_reject_outliers( ab_log_ratios, n, ab_kept );
+        result.ci = ab_confidence_interval( n );
+        if ( result.ci >= 0 && result.ci <= target_ci )
+          break;
+      }
+
+      if ( timer_clock() - start > 1E6 * budget )
+        break;
+    }
+
+    if ( !n )
+    {
+      result.status = "no error-free calls";
+      report_ab( &result );
+
+      return;
+    }
+
+    result.pairs    = n;
+    result.rejected = n - bench_reject_outliers( ab_log_ratios, n,
+                                                 ab_kept );
+    result.ci       = ab_confidence_interval( n );
+    result.a_us     = bench_median( ab_times[0], n );
+    result.b_us     = bench_median( ab_times[1], n );
+
+    for ( i = 0; i < n; i++ )
+      if ( ab_kept[i] )
+        sum += ab_log_ratios[i];
+    result.speedup = exp( sum / ( n - result.rejected ) );
+
+    /* like the baseline comparison, ignore changes below option `-T' */
+    if ( result.ci < 0 )
+      result.verdict = "inconclusive";
+    else if ( result.speedup / ( 1 + result.ci / 100 ) > 1          &&
+              100 * ( result.speedup - 1 ) > regression_threshold )
+      result.verdict = "faster";
+    else if ( result.speedup * ( 1 + result.ci / 100 ) < 1          &&
+              100 * ( 1 - result.speedup ) > regression_threshold )
+    {
+      result.verdict = "slower";
+      num_regressions++;
+    }
+    else
+      result.verdict = "same";
+
+    report_ab( &result );
+  }
+
+
+  static void
+  run_ab( FT_Face  face,
+          int      max_iter,
+          double   max_time )
+  {
+    size_t  i;
+
+
+    if ( output_format == FORMAT_TEXT )
+      printf( "A: %s (FreeType %s)\n"
+              "B: %s (FreeType %s)\n"
+              "\n"
+              "speedup of B (time of A divided by time of B):\n"
+              "\n"
+              "  %-25s %10s %10s %8s  %8s  %s\n",
+              ab_libs[0], ab_versions[0],
+              ab_libs[1], ab_versions[1],
+              "", "A us/op", "B us/op", "speedup", "95% CI", "verdict" );
+
+    if ( TEST( 'e' ) )
+      get_charset( face, &ab_charset );
+
+    for ( i = 0; i < sizeof ( ab_tests ) / sizeof ( ab_tests[0] ); i++ )
+    {
+      const babtest_t*  test = &ab_tests[i];
+
+
+      if ( !TEST( test->letter ) )
+        continue;
+
+      if ( test->need_size && !face_size )
+      {
+        babresult_t  result;
+
+
+        memset( &result, 0, sizeof ( result ) );
+        result.title  = test->title;
+        result.status = "disabled (size = 0)";
+        report_ab( &result );
+
+        continue;
+      }
+
+      if ( test->user_data == &ab_charset && !ab_charset.code )
+        continue;
+
+      ab_benchmark( test, max_iter, max_time );
+    }
+
+    free( ab_charset.code );
+    ab_charset.code = NULL;
+  }
+
+#endif /* FTBENCH_AB */
+
+
+  /*
+   * Soak mode (option `-Q'): run a random mix of glyph loading and
+   * rendering at random sizes, cache lookups, and opening and closing
+   * faces for a long time, and report the throughput, the resident set
+   * size, and the bytes allocated by FreeType once per interval.  Slow
+   * growth of the latter two, for example by heap fragmentation, only
+   * shows up after many intervals.
+   */
+
+#define SOAK_MIN_SIZE  6   /* range of the random sizes, in ppem */
+#define SOAK_MAX_SIZE  96
+
+  /* the minimum number of intervals, the share of them with growth,  */
+  /* and the relative slope per hour for flagging steady growth       */
+#define SOAK_MIN_INTERVALS  8
+#define SOAK_MIN_RISES      0.75
+#define SOAK_MIN_SLOPE      0.01
+
+
+  /* the trend of a value measured once per interval */
+  typedef struct  btrend_t_ {
+    double  first;
+    double  last;
+    double  peak;
+    double  n, st, sv, stt, stv;  /* sums for the least-squares slope */
+    int     rises;                /* intervals with an increase */
+    int     falls;                /* intervals with a decrease */
+
+  } btrend_t;
+
+
+  /* the resident set size in bytes, or -1 if not available */
+  static double
+  get_rss( void )
+  {
+#if defined __linux__ && defined UNIX
+    FILE*  file;
+    long   size, resident;
+    int    n;
+
+
+    file = fopen( "/proc/self/statm", "r" );
+    if ( !file )
+      return -1;
+
+    n = fscanf( file, "%ld %ld", &size, &resident );
+    fclose( file );
+
+    if ( n != 2 )
+      return -1;
+
+    return (double)resident * (double)sysconf( _SC_PAGESIZE );
+#else
+    return -1;
+#endif
+  }
+
+
+  /* add value `v' measured at time `t' (in seconds) */
+  static void
+  trend_add( btrend_t*  trend,
+             double     t,
+             double     v )
+  {
+    if ( !trend->n )
+    {
+      trend->first = v;
+      trend->peak  = v;
+    }
+    else if ( v > trend->last )
+      trend->rises++;
+    else if ( v < trend->last )
+      trend->falls++;
+
+    if ( v > trend->peak )
+      trend->peak = v;
+    trend->last = v;
+
+    trend->n   += 1;
+    trend->st  += t;
+    trend->sv  += v;
+    trend->stt += t * t;
+    trend->stv += t * v;
+  }
+
+
+  /* the least-squares slope, per hour */
+  static double
+  trend_slope( btrend_t*  trend )
+  {
+    double  d = trend->n * trend->stt - trend->st * trend->st;
+
+
+    if ( trend->n < 2 || d <= 0 )
+      return 0;
+
+    return 3600 * ( trend->n * trend->stv - trend->st * trend->sv ) / d;
+  }
+
+
+  /*
+   * Steady growth: enough intervals, most of them with an increase, and
+   * a slope of at least `SOAK_MIN_SLOPE' of the first value per hour.
+   * A step during the warm-up of the caches followed by a flat line
+   * doesn't qualify.
+   */
+  static int
+  trend_growing( btrend_t*  trend )
+  {
+    return trend->n >= SOAK_MIN_INTERVALS                            &&
+           trend->rises >= SOAK_MIN_RISES * ( trend->n - 1 )         &&
+           trend->last > trend->first                                &&
+           trend_slope( trend ) >= SOAK_MIN_SLOPE * trend->first;
+  }
+
+
+  /* a random glyph index of the range of option `-i' */
+  static FT_UInt
+  random_index( FT_UInt32*  state )
+  {
+    FT_UInt  lo   = first_index < last_index ? first_index : last_index;
+    FT_UInt  span = first_index < last_index ? last_index - first_index
+                                             : first_index - last_index;
+
+
+    return lo + next_random( state ) % ( span + 1 );
+  }
+
+
+  /* One operation of the mix; return 1 if it succeeded.  Glyphs are */
+  /* loaded directly with face `load_face', since the cache manager   */
+  /* activates its own size objects in `face'.                        */
+  static int
+  soak_step( FT_Face      face,
+             FT_Face      load_face,
+             bcharset_t*  charset,
+             FT_UInt32*   state )
+  {
+    FT_UInt32  r    = next_random( state ) % 32;
+    FT_UInt    ppem = (FT_UInt)font_type.width;
+
+
+    if ( FT_IS_SCALABLE( face ) )
+      ppem = SOAK_MIN_SIZE +
+             next_random( state ) % ( SOAK_MAX_SIZE - SOAK_MIN_SIZE + 1 );
+
+    if ( r < 16 )
+    {
+      if ( FT_IS_SCALABLE( load_face )                     &&
+           FT_Set_Pixel_Sizes( load_face, ppem, ppem )     )
+        return 0;
+
+      if ( FT_Load_Glyph( load_face, random_index( state ), load_flags ) )
+        return 0;
+
+      if ( load_face->glyph->format == FT_GLYPH_FORMAT_OUTLINE &&
+           FT_Render_Glyph( load_face->glyph, render_mode )    )
+        return 0;
+
+      return 1;
+    }
+    else if ( r < 31 )
+    {
+      FTC_ImageTypeRec  type = font_type;
+      FT_Glyph          glyph;
+      FTC_SBit          sbit;
+      FT_ULong          charcode;
+
+
+      type.width  = ppem;
+      type.height = ppem;
+
+      switch ( r % 3 )
+      {
+      case 0:
+        return image_cache                                      &&
+               !FTC_ImageCache_Lookup( image_cache,
+                                       &type,
+                                       random_index( state ),
+                                       &glyph,
+                                       NULL );
+
+      case 1:
+        return sbit_cache                                       &&
+               !FTC_SBitCache_Lookup( sbit_cache,
+                                      &type,
+                                      random_index( state ),
+                                      &sbit,
+                                      NULL );
+
+      default:
+        if ( !cmap_cache || !charset->size )
+          return 0;
+
+        charcode = charset->code[next_random( state ) %
+                                 (FT_UInt32)charset->size];
+
+        return FTC_CMapCache_Lookup( cmap_cache,
+                                     font_type.face_id,
+                                     0,
+                                     charcode ) != 0;
+      }
+    }
+    else
+    {
+      FT_Face   new_face;
+      FT_Byte*  data;
+      size_t    data_size;
+      int       done = 0;
+
+
+      if ( !get_new_face( &new_face, &data, &data_size ) )
+      {
+        if ( !set_face_size( new_face )                               &&
+             !FT_Load_Glyph( new_face, random_index( state ), load_flags ) )
+          done = 1;
+
+        FT_Done_Face( new_face );
+      }
+
+      unload_font_data( preload, data, data_size );
+
+      return done;
+    }
+  }
+
+
+  /* `key' is used in JSON output, `name' in text and warnings; */
+  /* growth counts as a regression (for the exit code) if `fail'  */
+  /* is set                                                       */
+  static void
+  report_trend( const char*  key,
+                const char*  name,
+                btrend_t*    trend,
+                int          fail )
+  {
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      printf( "    " );
+      print_string( key );
+      printf( ": { \"first\": %.0f, \"last\": %.0f, \"peak\": %.0f,"
+              " \"slope_per_hour\": %.0f, \"growing\": %s }",
+              trend->first,
+              trend->last,
+              trend->peak,
+              trend_slope( trend ),
+              trend_growing( trend ) ? "true" : "false" );
+      break;
+
+    case FORMAT_TEXT:
+      printf( "  %-5s first %.0f KiB, last %.0f KiB, peak %.0f KiB,"
+              " %+.1f KiB/h%s\n",
+              name,
+              trend->first / 1024,
+              trend->last / 1024,
+              trend->peak / 1024,
+              trend_slope( trend ) / 1024,
+              trend_growing( trend ) ? ", steady growth <<<" : "" );
+      break;
+    }
+
+    if ( trend_growing( trend ) )
+    {
+      fflush( stdout );
+      fprintf( stderr,
+               "warning: %s grew steadily from %.0f to %.0f bytes\n",
+               name, trend->first, trend->last );
+      if ( fail )
+        num_regressions++;
+    }
+  }
+
+
+  static void
+  run_soak( FT_Face  face )
+  {
+    bcharset_t  charset;
+    btrend_t    rss, heap;
+    FT_Face     load_face;
+    FT_UInt32   state = 2463534242UL;
+    double      start, last, now;
+    double      ops = 0, last_ops = 0;
+    int         interval = 0;
+
+
+    memset( &rss, 0, sizeof ( rss ) );
+    memset( &heap, 0, sizeof ( heap ) );
+
+    if ( get_face( &load_face ) )
+      return;
+    set_face_size( load_face );
+
+    charset.size = 0;
+    get_charset( face, &charset );
+
+    if ( FTC_CMapCache_New( cache_man, &cmap_cache )   ||
+         FTC_ImageCache_New( cache_man, &image_cache ) ||
+         FTC_SBitCache_New( cache_man, &sbit_cache )   )
+      fprintf( stderr, "warning: couldn't create all caches\n" );
+
+    if ( output_format == FORMAT_TEXT )
+      printf( "soak test: %g seconds, reported every %g seconds\n"
+              "  (loading and rendering at %d to %dppem, cache lookups,\n"
+              "  and opening and closing faces; the first interval is\n"
+              "  a warm-up and not part of the trends)\n"
+              "\n"
+              "     elapsed          ops       ops/s     RSS KiB"
+              "    heap KiB\n",
+              soak_time,
+              soak_interval,
+              SOAK_MIN_SIZE,
+              SOAK_MAX_SIZE );
+    fflush( stdout );
+
+    start = last = bench_wall_time();
+
+    do
+    {
+      ops += soak_step( face, load_face, &charset, &state );
+
+      now = bench_wall_time();
+      if ( now - last >= 1E6 * soak_interval      ||
+           now - start >= 1E6 * soak_time         )
+      {
+        double  t     = 1E-6 * ( now - start );
+        double  rate  = 1E6 * ( ops - last_ops ) / ( now - last );
+        double  bytes = get_rss();
+
+
+        if ( interval++ )
+        {
+          if ( bytes >= 0 )
+            trend_add( &rss, t, bytes );
+          trend_add( &heap, t, mem_live );
+        }
+
+        switch ( output_format )
+        {
+        case FORMAT_JSON:
+          printf( "%s    { \"elapsed\": %.1f, \"ops\": %.0f,"
+                  " \"ops_per_s\": %.6g, \"rss\": ",
+                  num_results ? ",\n" : "",
+                  t, ops, rate );
+          if ( bytes >= 0 )
+            printf( "%.0f", bytes );
+          else
+            printf( "null" );
+          printf( ", \"heap\": %.0f,"
+                  " \"rss_growing\": %s, \"heap_growing\": %s }",
+                  mem_live,
+                  trend_growing( &rss ) ? "true" : "false",
+                  trend_growing( &heap ) ? "true" : "false" );
+          break;
+
+        case FORMAT_CSV:
+          print_csv_settings( filename, info.family, info.style );
+          printf( "%.1f,%.0f,%.6g,", t, ops, rate );
+          if ( bytes >= 0 )
+            printf( "%.0f", bytes );
+          printf( ",%.0f,%d,%d\n",
+                  mem_live,
+                  trend_growing( &rss ),
+                  trend_growing( &heap ) );
+          break;
+
+        default:
+          printf( "  %10.1f %12.0f %11.1f ", t, ops, rate );
+          if ( bytes >= 0 )
+            printf( "%11.0f", bytes / 1024 );
+          else
+            printf( "%11s", "n/a" );
+          printf( " %11.0f%s%s\n",
+                  mem_live / 1024,
+                  trend_growing( &rss ) ? "  RSS growing" : "",
+                  trend_growing( &heap ) ? "  heap growing" : "" );
+        }
+
+        num_results++;
+        fflush( stdout );
+
+        last     = now;
+        last_ops = ops;
+      }
+
+    } while ( now - start < 1E6 * soak_time );
+
+    /* instead of `report_end' */
+    if ( output_format == FORMAT_JSON )
+      printf( "%s  ],\n"
+              "  \"soak\": {\n",
+              num_results ? "\n" : "" );
+    else if ( output_format == FORMAT_TEXT )
+      printf( "\n"
+              "trends:\n" );
+
+    if ( rss.n )
+    {
+      /* the RSS also depends on the C library's allocator */
+      report_trend( "rss", "RSS", &rss, 0 );
+      if ( output_format == FORMAT_JSON )
+        printf( ",\n" );
+    }
+    if ( heap.n )
+    {
+      report_trend( "heap", "heap", &heap, 1 );
+      if ( output_format == FORMAT_JSON )
+        printf( "\n" );
+    }
+
+    if ( output_format == FORMAT_JSON )
+      printf( "  }\n"
+              "}\n" );
+
+    FT_Done_Face( load_face );
+    free( charset.code );
+  }
+
+
+  /*
+   * Corpus mode: benchmark all faces and named instances of several font
+   * files (or of all font files in directories) with a pool of worker
+   * threads, then rank the fonts by their cost.
+   */
+
+  typedef struct  bcorpus_t_
+  {
+    char**    files;
+    int       num_files;
+    int       max_files;
+    bfont_t*  fonts;
+    int       num_fonts;
+    int       max_fonts;
+    int       next_font;  /* the next font to be taken by a worker */
+    int       max_iter;
+    double    max_time;
+    int       next_worker;  /* for pinning the workers to CPUs */
+
+  } bcorpus_t;
+
+
+  static bcorpus_t  corpus;
+  static int        num_workers = 1;
+
+#ifdef FTBENCH_THREADS
+  static pthread_mutex_t  corpus_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+  static char*
+  copy_string( const char*  s )
+  {
+    char*  copy;
+
+
+    if ( !s )
+      return NULL;
+
+    copy = (char*)malloc( strlen( s ) + 1 );
+    if ( copy )
+      strcpy( copy, s );
+
+    return copy;
+  }
+
+
+#ifdef UNIX
+
+  static int
+  compare_strings( const void*  a,
+                   const void*  b )
+  {
+    return strcmp( *(char* const*)a, *(char* const*)b );
+  }
+
+#endif /* UNIX */
+
+
+  /* sort by decreasing score, fonts that failed last */
+  static int
+  compare_fonts( const void*  a,
+                 const void*  b )
+  {
+    const bfont_t*  fa = (const bfont_t*)a;
+    const bfont_t*  fb = (const bfont_t*)b;
+
+
+    if ( !fa->status != !fb->status )
+      return fa->status ? 1 : -1;
+
+    return ( fa->score < fb->score ) - ( fa->score > fb->score );
+  }
+
+
+  /*
+   * Score the fonts of the corpus: divide every time per operation by
+   * the median of all fonts for the same test (identified by its title),
+   * then take the geometric mean of these ratios, so that a single
+   * expensive test doesn't dominate the ranking.  Only tests with
+   * results for every benchmarked font are scored, so that all fonts are
+   * ranked on the same tests.
+   */
+  static void
+  score_corpus( void )
+  {
+    const char**  titles;
+    double*       values;
+    int           num_titles = 0, num_fonts = 0, total = 0;
+    int           i, j, k;
+
+
+    for ( i = 0; i < corpus.num_fonts; i++ )
+    {
+      total += corpus.fonts[i].num_results;
+      if ( !corpus.fonts[i].status )
+        num_fonts++;
+    }
+
+    titles = (const char**)malloc( (size_t)( total ? total : 1 ) *
+                                   sizeof ( char* ) );
+    values = (double*)malloc( (size_t)corpus.num_fonts *
+                              sizeof ( double ) );
+    if ( !titles || !values )
+    {
+      free( titles );
+      free( values );
+
+      return;
+    }
+
+    /* collect the distinct titles */
+    for ( i = 0; i < corpus.num_fonts; i++ )
+      for ( j = 0; j < corpus.fonts[i].num_results; j++ )
+      {
+        const char*  title = corpus.fonts[i].results[j].title;
+
+
+        if ( !title )
+          continue;
+
+        for ( k = 0; k < num_titles; k++ )
+          if ( !strcmp( titles[k], title ) )
+            break;
+        if ( k == num_titles )
+          titles[num_titles++] = title;
+      }
+
+    for ( k = 0; k < num_titles; k++ )
+    {
+      double  median;
+      int     n = 0;
+
+
+      for ( i = 0; i < corpus.num_fonts; i++ )
+        for ( j = 0; j < corpus.fonts[i].num_results; j++ )
+        {
+          bfontresult_t*  r = &corpus.fonts[i].results[j];
+
+
+          if ( r->done && r->time > 0 && r->title    &&
+               !strcmp( r->title, titles[k] )        )
+            values[n++] = r->time / r->done;
+        }
+
+      if ( n < num_fonts )
+        continue;
+
+      median = bench_median( values, n );
+      if ( median <= 0 )
+        continue;
+
+      for ( i = 0; i < corpus.num_fonts; i++ )
+        for ( j = 0; j < corpus.fonts[i].num_results; j++ )
+        {
+          bfontresult_t*  r = &corpus.fonts[i].results[j];
+
+
+          if ( r->done && r->time > 0 && r->title    &&
+               !strcmp( r->title, titles[k] )        )
+            r->relative = r->time / r->done / median;
+        }
+    }
+
+    for ( i = 0; i < corpus.num_fonts; i++ )
+    {
+      bfont_t*  font = &corpus.fonts[i];
+      double    sum  = 0;
+      int       n    = 0;
+
+
+      for ( j = 0; j < font->num_results; j++ )
+        if ( font->results[j].relative > 0 )
+        {
+          sum += log( font->results[j].relative );
+          n++;
+        }
+
+      font->score = n ? exp( sum / n ) : 0;
+    }
+
+    free( titles );
+    free( values );
+  }
+
+
+  static int
+  is_directory( const char*  path )
+  {
+#ifdef UNIX
+    struct stat  st;
+
+
+    return !stat( path, &st ) && S_ISDIR( st.st_mode );
+#else
+    FT_UNUSED( path );
+
+    return 0;
+#endif
+  }
+
+
+  /* add all faces and named instances of a font file to the corpus */
+  static void
+  add_font_file( const char*  path )
+  {
+    FT_Face  face;
+    FT_Long  num_faces, i, j, num_instances;
+    char*    name;
+
+
+    /* silently ignore files that aren't fonts */
+    if ( FT_New_Face( lib, path, -1, &face ) )
+      return;
+    num_faces = face->num_faces;
+    FT_Done_Face( face );
+
+    if ( corpus.num_files == corpus.max_files )
+    {
+      int     max   = corpus.max_files ? 2 * corpus.max_files : 64;
+      char**  files = (char**)realloc( corpus.files,
+                                       (size_t)max * sizeof ( char* ) );
+
+
+      if ( !files )
+        return;
+      corpus.files     = files;
+      corpus.max_files = max;
+    }
+
+    name = copy_string( path );
+    if ( !name )
+      return;
+    corpus.files[corpus.num_files++] = name;
+
+    for ( i = 0; i < num_faces; i++ )
+    {
+      if ( FT_New_Face( lib, path, i, &face ) )
+        continue;
+      num_instances = face->style_flags >> 16;
+      FT_Done_Face( face );
+
+      /* named instances replace the default one */
+      for ( j = num_instances ? 1 : 0; j <= num_instances; j++ )
+      {
+        bfont_t*  font;
+
+
+        if ( corpus.num_fonts == corpus.max_fonts )
+        {
+          int       max   = corpus.max_fonts ? 2 * corpus.max_fonts : 64;
+          bfont_t*  fonts = (bfont_t*)realloc( corpus.fonts,
+                                               (size_t)max *
+                                                 sizeof ( bfont_t ) );
+
+
+          if ( !fonts )
+            return;
+          corpus.fonts     = fonts;
+          corpus.max_fonts = max;
+        }
+
+        font = &corpus.fonts[corpus.num_fonts++];
+        memset( font, 0, sizeof ( *font ) );
+        font->filename   = name;
+        font->face_index = ( j << 16 ) | i;
+      }
+    }
+  }
+
+
+  /* add a font file or, recursively, all font files of a directory */
+  static void
+  add_fonts( const char*  path )
+  {
+#ifdef UNIX
+    if ( is_directory( path ) )
+    {
+      DIR*            dir;
+      struct dirent*  entry;
+      char**          names     = NULL;
+      size_t          num_names = 0;
+      size_t          max_names = 0;
+      size_t          k;
+
+
+      dir = opendir( path );
+      if ( !dir )
+      {
+        fprintf( stderr, "couldn't open directory `%s'\n", path );
+
+        return;
+      }
+
+      /* sort the entries to get a reproducible order */
+      while ( ( entry = readdir( dir ) ) != NULL )
+      {
+        char*  name;
+
+
+        /* skip `.', `..', and hidden files */
+        if ( entry->d_name[0] == '.' )
+          continue;
+
+        if ( num_names == max_names )
+        {
+          size_t  max = max_names ? 2 * max_names : 64;
+          char**  tmp = (char**)realloc( names, max * sizeof ( char* ) );
+
+
+          if ( !tmp )
+            break;
+          names     = tmp;
+          max_names = max;
+        }
+
+        name = (char*)malloc( strlen( path ) + strlen( entry->d_name ) + 2 );
+        if ( !name )
+          break;
+        sprintf( name, "%s/%s", path, entry->d_name );
+        names[num_names++] = name;
+      }
+
+      closedir( dir );
+
+      qsort( names, num_names, sizeof ( char* ), compare_strings );
+
+      for ( k = 0; k < num_names; k++ )
+      {
+        add_fonts( names[k] );
+        free( names[k] );
+      }
+      free( names );
+
+      return;
+    }
+#endif
+
+    add_font_file( path );
+  }
+
+
+  /* run a test on the current font of a worker, without reporting */
+  static void
+  benchmark_font( FT_Face   face,
+                  btest_t*  test,
+                  int       max_iter,
+                  double    max_time )
+  {
+    static THREAD_LOCAL bsamples_t  samples;
+    static THREAD_LOCAL bmem_t      mem;
+
+    bfont_t*        font = current_font;
+    bfontresult_t*  result;
+    btimer_t        timer;
+
+
+    if ( font->num_results == font->max_results )
+    {
+      int             max     = font->max_results + FONT_RESULTS_STEP;
+      bfontresult_t*  results = (bfontresult_t*)realloc(
+                                  font->results,
+                                  (size_t)max * sizeof ( bfontresult_t ) );
+
+
+      if ( !results )
+      {
+        font->dropped++;
+        return;
+      }
+
+      font->results     = results;
+      font->max_results = max;
+    }
+
+    timer.histo = NULL;
+    timer.perf  = NULL;
+    timer.mem   = count_allocs ? &mem : NULL;
+
+    bench_warmup( face, test );
+    bench_reset( &timer );
+
+    result        = &font->results[font->num_results++];
+    result->title = copy_string( test->title );
+    result->done  = bench_loop( face,
+                                test,
+                                &timer,
+                                &samples,
+                                max_iter,
+                                max_time );
+    result->time  = TIMER_GET( &timer );
+    result->bytes = timer.mem ? timer.mem->bytes : 0;
+
+    if ( result->done )
+      font->cost += result->time / result->done;
+  }
+
+
+  static void
+  free_font_results( bfont_t*  font )
+  {
+    int  i;
+
+
+    if ( font->dropped )
+      fprintf( stderr, "ftbench: %d result%s of `%s' dropped"
+                       " (out of memory)\n",
+                       font->dropped,
+                       font->dropped == 1 ? "" : "s",
+                       font->filename ? font->filename : filename );
+
+    for ( i = 0; i < font->num_results; i++ )
+      free( font->results[i].title );
+    free( font->results );
+
+    font->results     = NULL;
+    font->num_results = 0;
+    font->max_results = 0;
+  }
+
+
+  static void
+  bench_font( bfont_t*  font )
+  {
+    FT_Face  face;
+
+
+    filename     = font->filename;
+    face_index   = font->face_index;
+    current_font = font;
+
+    if ( open_font( &face ) )
+      font->status = "couldn't open font or set size";
+    else
+    {
+      int  i;
+
+
+      font->family = copy_string( face->family_name );
+      font->style  = copy_string( face->style_name );
+
+      run_tests( face, corpus.max_iter, corpus.max_time );
+
+      for ( i = 0; i < font->num_results; i++ )
+        if ( font->results[i].done )
+          break;
+      if ( i == font->num_results )
+        font->status = "no error-free calls";
+    }
+
+    close_font();
+    current_font = NULL;
+  }
+
+
+  static void*
+  corpus_worker( void*  arg )
+  {
+    int  index;
+
+
+    FT_UNUSED( arg );
+
+#ifdef FTBENCH_THREADS
+    pthread_mutex_lock( &corpus_mutex );
+#endif
+    index = corpus.next_worker++;
+#ifdef FTBENCH_THREADS
+    pthread_mutex_unlock( &corpus_mutex );
+#endif
+
+    pin_thread( index );
+
+    while ( 1 )
+    {
+      int  i;
+
+
+#ifdef FTBENCH_THREADS
+      pthread_mutex_lock( &corpus_mutex );
+#endif
+      i = corpus.next_font++;
+#ifdef FTBENCH_THREADS
+      pthread_mutex_unlock( &corpus_mutex );
+#endif
+
+      if ( i >= corpus.num_fonts )
+        break;
+
+      bench_font( &corpus.fonts[i] );
+    }
+
+    return NULL;
+  }
+
+
+  /* benchmark all fonts of the corpus, then report */
+  static void
+  run_corpus( int     max_iter,
+              double  max_time )
+  {
+    double  start, wall, total = 0;
+    int     i;
+
+
+    corpus.max_iter    = max_iter;
+    corpus.max_time    = max_time;
+    corpus.next_font   = 0;
+    corpus.next_worker = 0;
+
+#ifdef FTBENCH_THREADS
+    {
+      pthread_t*  workers;
+      int         created;
+
+
+      workers = (pthread_t*)calloc( (size_t)num_workers,
+                                    sizeof ( pthread_t ) );
+      if ( !workers )
+      {
+        fprintf( stderr, "couldn't allocate worker threads\n" );
+
+        return;
+      }
+
+      start = bench_wall_time();
+
+      /* the main thread's library is left alone */
+      for ( created = 0; created < num_workers; created++ )
+        if ( pthread_create( &workers[created],
+                             NULL,
+                             corpus_worker,
+                             NULL ) )
+          break;
+
+      if ( !created )
+      {
+        fprintf( stderr, "couldn't create worker threads\n" );
+        free( workers );
+
+        return;
+      }
+
+      for ( i = 0; i < created; i++ )
+        pthread_join( workers[i], NULL );
+
+      wall = bench_wall_time() - start;
+
+      free( workers );
+    }
+#else
+    {
+      FT_Library  main_lib = lib;
+
+
+      start = bench_wall_time();
+      corpus_worker( NULL );
+      wall  = bench_wall_time() - start;
+
+      lib = main_lib;
+    }
+#endif
+
+    score_corpus();
+
+    qsort( corpus.fonts,
+           (size_t)corpus.num_fonts,
+           sizeof ( bfont_t ),
+           compare_fonts );
+
+    for ( i = 0; i < corpus.num_fonts; i++ )
+      if ( !corpus.fonts[i].status )
+        total += corpus.fonts[i].cost;
+
+    for ( i = 0; i < corpus.num_fonts; i++ )
+      report_font( &corpus.fonts[i], i + 1, total );
+
+    report_corpus_end( corpus.fonts, corpus.num_fonts, wall );
+  }
+
+
+  static void
+  free_corpus( void )
+  {
+    int  i;
+
+
+    for ( i = 0; i < corpus.num_fonts; i++ )
+    {
+      free( corpus.fonts[i].family );
+      free( corpus.fonts[i].style );
+      free_font_results( &corpus.fonts[i] );
+    }
+    for ( i = 0; i < corpus.num_files; i++ )
+      free( corpus.files[i] );
+
+    free( corpus.fonts );
+    free( corpus.files );
+  }
+
+
+  /*
+   * Hinting matrix (option `-X'): run the tests once for every
+   * combination of the selected hinting settings, each with a new library
+   * and face, then report all results together.
+   */
+
+  typedef struct  btarget_t_
+  {
+    const char*     name;
+    FT_Int32        flags;
+    FT_Render_Mode  mode;
+
+  } btarget_t;
+
+  /* indexed by render mode */
+  static const btarget_t  targets[] =
+  {
+    { "normal", FT_LOAD_TARGET_NORMAL, FT_RENDER_MODE_NORMAL },
+    { "light",  FT_LOAD_TARGET_LIGHT,  FT_RENDER_MODE_LIGHT },
+    { "mono",   FT_LOAD_TARGET_MONO,   FT_RENDER_MODE_MONO },
+    { "lcd",    FT_LOAD_TARGET_LCD,    FT_RENDER_MODE_LCD },
+    { "lcd_v",  FT_LOAD_TARGET_LCD_V,  FT_RENDER_MODE_LCD_V }
+  };
+
+#define N_TARGETS  (int)( sizeof ( targets ) / sizeof ( targets[0] ) )
+
+  static const FT_LcdFilter  lcd_filters[] =
+  {
+    FT_LCD_FILTER_NONE,
+    FT_LCD_FILTER_DEFAULT,
+    FT_LCD_FILTER_LIGHT,
+    FT_LCD_FILTER_LEGACY
+  };
+
+#define N_LCD_FILTERS  4
+
+#define MAX_CONFIGS  ( 3 * 2 * N_TARGETS * N_LCD_FILTERS + \
+                       N_TARGETS * N_LCD_FILTERS         )
+
+
+  typedef struct  bconfig_t_
+  {
+    int      interpreter;  /* -1 if not relevant for the font */
+    int      engine;       /* ditto */
+    int      autohint;
+    int      target;       /* index into `targets' */
+    int      lcd_filter;   /* -1 if not set */
+    bfont_t  font;         /* the results */
+
+  } bconfig_t;
+
+
+#define MATRIX( x )  ( strchr( matrix_dims, (x) ) != NULL )
+
+
+  /* set the global variables used by `open_font' and the tests */
+  static void
+  apply_config( bconfig_t*  config,
+                FT_Int32    base_flags )
+  {
+    const btarget_t*  target = &targets[config->target];
+
+
+    load_flags  = base_flags;
+    render_mode = target->mode;
+    if ( MATRIX( 't' ) )
+      load_flags |= target->flags;
+    if ( MATRIX( 'a' ) && config->autohint )
+      load_flags |= FT_LOAD_FORCE_AUTOHINT;
+
+    lcd_filter_set = config->lcd_filter >= 0;
+    lcd_filter     = lcd_filter_set ? (FT_LcdFilter)config->lcd_filter
+                                    : FT_LCD_FILTER_NONE;
+
+    if ( config->interpreter >= 0 )
+    {
+      tt_interpreter_version = config->interpreter;
+      info.interpreter       = config->interpreter;
+    }
+    if ( config->engine >= 0 )
+    {
+      ps_hinting_engine = config->engine;
+      info.engine       = ps_hinting_engine_names[config->engine];
+    }
+  }
+
+
+  /* enumerate the configurations for a font of format `format' */
+  static int
+  get_configs( const char*  format,
+               bconfig_t*   configs )
+  {
+    int  is_tt = !strcmp( format, "TrueType" );
+    int  is_ps = !strcmp( format, "CFF" )        ||
+                 !strcmp( format, "Type 1" )     ||
+                 !strcmp( format, "CID Type 1" );
+
+    int  interpreters[3], engines[2];
+    int  num_interpreters = 1, num_engines = 1;
+    int  a, i, e, t, f, n = 0;
+
+
+    /* dimensions that are not selected keep the current setting */
+    interpreters[0] = is_tt ? ( tt_interpreter_version >= 0
+                                  ? tt_interpreter_version
+                                  : (int)dflt_tt_interpreter_version )
+                            : -1;
+    engines[0]      = is_ps ? ( ps_hinting_engine >= 0
+                                  ? ps_hinting_engine
+                                  : (int)dflt_ps_hinting_engine )
+                            : -1;
+
+    if ( is_tt && MATRIX( 'i' ) )
+    {
+      num_interpreters = num_tt_interpreter_versions;
+      for ( i = 0; i < num_interpreters; i++ )
+        interpreters[i] = (int)tt_interpreter_versions[i];
+    }
+    if ( is_ps && MATRIX( 'h' ) )
+    {
+      num_engines = num_ps_hinting_engines;
+      for ( e = 0; e < num_engines; e++ )
+        engines[e] = (int)ps_hinting_engines[e];
+    }
+
+    for ( a = 0; a < 2; a++ )
+    {
+      if ( !MATRIX( 'a' )                                   &&
+           a != !!( load_flags & FT_LOAD_FORCE_AUTOHINT ) )
+        continue;
+
+      /* the auto-hinter ignores the font's hinting engine */
+      for ( i = 0; i < ( a ? 1 : num_interpreters ); i++ )
+        for ( e = 0; e < ( a ? 1 : num_engines ); e++ )
+          for ( t = 0; t < N_TARGETS; t++ )
+          {
+            int  lcd = targets[t].mode == FT_RENDER_MODE_LCD   ||
+                       targets[t].mode == FT_RENDER_MODE_LCD_V;
+
+
+            if ( !MATRIX( 't' ) && targets[t].mode != render_mode )
+              continue;
+
+            /* LCD filters only apply to subpixel rendering */
+            for ( f = 0; f < ( lcd && MATRIX( 'l' ) ? N_LCD_FILTERS
+                                                    : 1 ); f++ )
+            {
+              bconfig_t*  config = &configs[n++];
+
+
+              config->interpreter = a ? -1 : interpreters[i];
+              config->engine      = a ? -1 : engines[e];
+              config->autohint    = a;
+              config->target      = t;
+
+              if ( lcd && MATRIX( 'l' ) )
+                config->lcd_filter = (int)lcd_filters[f];
+              else if ( lcd && lcd_filter_set )
+                config->lcd_filter = (int)lcd_filter;
+              else
+                config->lcd_filter = -1;
+            }
+          }
+    }
+
+    return n;
+  }
+
+
+  static void
+  report_config( bconfig_t*  config,
+                 int         num_titles,
+                 char**      titles )
+  {
+    bfont_t*  font = &config->font;
+    int       i, j;
+
+
+    switch ( output_format )
+    {
+    case FORMAT_JSON:
+      for ( i = 0; i < font->num_results; i++ )
+      {
+        bfontresult_t*  r = &font->results[i];
+
+
+        printf( "%s    { \"test\": ", num_results++ ? ",\n" : "" );
+        print_string( r->title );
+        printf( ", \"interpreter_version\": " );
+        if ( config->interpreter >= 0 )
+          printf( "%d", config->interpreter );
+        else
+          printf( "null" );
+        printf( ", \"hinting_engine\": " );
+        if ( config->engine >= 0 )
+          print_string( ps_hinting_engine_names[config->engine] );
+        else
+          printf( "null" );
+        printf( ", \"autohint\": %s, \"target\": ",
+                config->autohint ? "true" : "false" );
+        print_string( targets[config->target].name );
+        printf( ", \"lcd_filter\": " );
+        if ( config->lcd_filter >= 0 )
+          printf( "%d", config->lcd_filter );
+        else
+          printf( "null" );
+        printf( ", \"status\": " );
+        print_string( font->status ? font->status
+                                   : r->done ? "ok"
+                                             : "no error-free calls" );
+        if ( r->done )
+          printf( ", \"done\": %d, \"us_per_op\": %.6g",
+                  r->done, r->time / r->done );
+        printf( " }" );
+      }
+      break;
+
+    case FORMAT_CSV:
+      for ( i = 0; i < font->num_results; i++ )
+      {
+        bfontresult_t*  r = &font->results[i];
+
+
+        print_csv_settings( filename, info.family, info.style );
+        print_string( r->title );
+        putchar( ',' );
+        print_string( targets[config->target].name );
+        printf( ",%d,", config->autohint );
+        print_string( font->status ? font->status
+                                   : r->done ? "ok"
+                                             : "no error-free calls" );
+        printf( ",%d,", r->done );
+        if ( r->done )
+          printf( "%.6g", r->time / r->done );
+        putchar( '\n' );
+      }
+      break;
+
+    default:
+      if ( config->interpreter >= 0 )
+        printf( "  %6d", config->interpreter );
+      else
+        printf( "  %6s", "-" );
+      printf( "  %-8s  %-4s  %-6s  ",
+              config->engine >= 0 ? ps_hinting_engine_names[config->engine]
+                                  : "-",
+              config->autohint ? "yes" : "no",
+              targets[config->target].name );
+      if ( config->lcd_filter >= 0 )
+        printf( "%3d", config->lcd_filter );
+      else
+        printf( "%3s", "-" );
+
+      for ( i = 0; i < num_titles; i++ )
+      {
+        for ( j = 0; j < font->num_results; j++ )
+          if ( !strcmp( font->results[j].title, titles[i] ) )
+            break;
+
+        if ( j < font->num_results && font->results[j].done )
+          printf( " %9.3f",
+                  font->results[j].time / font->results[j].done );
+        else
+          printf( " %9s", "-" );
+      }
+
+      if ( font->status )
+        printf( "  %s\n", font->status );
+      else
+        printf( " %10.3f\n", font->cost );
+    }
+  }
+
+
+  static void
+  run_matrix( int     max_iter,
+              double  max_time )
+  {
+    FT_Library   main_lib   = lib;
+    FT_Int32     base_flags = load_flags;
+    FT_Face      face;
+    bconfig_t*   configs;
+    char**       titles;
+    char         label[16];
+    char*        family;
+    char*        style;
+    const char*  format;
+    int          num_configs, num_titles = 0;
+    int          i, j, n = 0;
+
+
+    configs = (bconfig_t*)calloc( MAX_CONFIGS, sizeof ( bconfig_t ) );
+    if ( !configs )
+    {
+      fprintf( stderr, "couldn't allocate configurations\n" );
+
+      return;
+    }
+
+    /* a first look at the font to find the relevant settings */
+    if ( open_font( &face ) )
+    {
+      fprintf( stderr, "couldn't open font or set size\n" );
+      close_font();
+      lib = main_lib;
+      free( configs );
+
+      return;
+    }
+
+    format      = FT_Get_Font_Format( face );
+    num_configs = get_configs( format ? format : "", configs );
+
+    report_begin( face );
+    if ( output_format == FORMAT_TEXT )
+      printf( "hinting matrix: %d configurations\n"
+              "\n",
+              num_configs );
+
+    /* the face gets closed, but the names are still needed */
+    family      = copy_string( face->family_name );
+    style       = copy_string( face->style_name );
+    info.family = family;
+    info.style  = style;
+
+    close_font();
+    lib = main_lib;
+
+    /* the bits set by the configurations */
+    if ( MATRIX( 't' ) )
+      base_flags &= ~FT_LOAD_TARGET_( 15 );
+    if ( MATRIX( 'a' ) )
+      base_flags &= ~FT_LOAD_FORCE_AUTOHINT;
+
+    for ( i = 0; i < num_configs; i++ )
+    {
+      bfont_t*  font = &configs[i].font;
+
+
+      apply_config( &configs[i], base_flags );
+
+      current_font = font;
+
+      if ( open_font( &face ) )
+        font->status = "couldn't open font or set size";
+      else
+        run_tests( face, max_iter, max_time );
+
+      close_font();
+      lib          = main_lib;
+      current_font = NULL;
+
+      n += font->num_results;
+    }
+
+    /* collect the test titles in order of appearance */
+    titles = (char**)malloc( (size_t)( n ? n : 1 ) * sizeof ( char* ) );
+    if ( !titles )
+      fprintf( stderr, "couldn't allocate test titles\n" );
+
+    for ( i = 0; titles && i < num_configs; i++ )
+    {
+      bfont_t*  font = &configs[i].font;
+
+
+      for ( j = 0; j < font->num_results; j++ )
+      {
+        int  k;
+
+
+        for ( k = 0; k < num_titles; k++ )
+          if ( !strcmp( titles[k], font->results[j].title ) )
+            break;
+
+        if ( k == num_titles )
+          titles[num_titles++] = font->results[j].title;
+      }
+    }
+
+    if ( output_format == FORMAT_TEXT )
+    {
+      printf( "tests (times in us/op):\n" );
+      for ( j = 0; j < num_titles; j++ )
+      {
+        snprintf( label, sizeof ( label ), "#%d", j + 1 );
+        printf( "  %4s  %s\n", label, titles[j] );
+      }
+
+      printf( "\n"
+              "  interp  engine    auto  target  lcd" );
+      for ( j = 0; j < num_titles; j++ )
+      {
+        snprintf( label, sizeof ( label ), "#%d", j + 1 );
+        printf( " %9s", label );
+      }
+      printf( "      total\n" );
+    }
+
+    for ( i = 0; i < num_configs; i++ )
+    {
+      apply_config( &configs[i], base_flags );
+      report_config( &configs[i], num_titles, titles );
+    }
+
+    report_end();
+
+    for ( i = 0; i < num_configs; i++ )
+      free_font_results( &configs[i].font );
+    free( configs );
+    free( titles );
+    free( family );
+    free( style );
+  }
+
+
+  int
+  main( int     argc,
+        char**  argv )
+  {
+    FT_Face   face;
+    FT_Error  error;
+
+    int            max_iter = 0;
+    double         max_time = BENCH_TIME;
+    int            j;
+    double         values[MAX_LIST_VALUES];
+
+    unsigned int  versions[3] = { TT_INTERPRETER_VERSION_35,
+                                  TT_INTERPRETER_VERSION_38,
+                                  TT_INTERPRETER_VERSION_40 };
+    unsigned int  engines[2]  = { FT_HINTING_FREETYPE,
+                                  FT_HINTING_ADOBE };
+    int           version;
+    char         *engine;
+
+
+    bench_init();
+
+    if ( FT_Init_FreeType( &lib ) )
+    {
+      fprintf( stderr, "could not initialize font library\n" );
+
+      return 1;
+    }
+
+
+    /* collect all available versions, then set again the default */
     FT_Property_Get( lib,
                      "truetype",
                      "interpreter-version", &dflt_tt_interpreter_version );
@@ -1063,13 +10042,32 @@
       int  opt;
 
 
-      opt = getopt( argc, argv, "b:Cc:f:H:I:i:l:m:pr:s:t:v" );
+      opt = getopt( argc, argv, "A:aB:b:CD:c:dE:eF:f:GH:I:i:j:K:k:L:l:M:m:Oo:P:pQ:q:R:r:S:s:T:t:u:V:vW:w:X:y:Z:z:" );
 
       if ( opt == -1 )
         break;
 
       switch ( opt )
       {
+      case 'A':
+#ifdef FTBENCH_AFFINITY
+        pin_cpu = atoi( optarg );
+        if ( pin_cpu < 0 )
+          usage();
+#else
+        fprintf( stderr,
+                 "warning: pinning threads to CPUs not available\n" );
+#endif
+        break;
+
+      case 'a':
+        count_allocs = 1;
+        break;
+
+      case 'B':
+        save_baseline_file = optarg;
+        break;
+
       case 'b':
         test_string = optarg;
         break;
@@ -1078,16 +10076,67 @@
         compare_cached = 1;
         break;
 
+      case 'D':
+#ifdef FTBENCH_IO_LATENCY
+        io_latency  = atof( optarg );
+        if ( io_latency < 0 )
+          io_latency = -io_latency;
+        use_streams = 1;
+#else
+        fprintf( stderr,
+                 "warning: injecting I/O latency not available\n" );
+#endif
+        break;
+
       case 'c':
         max_iter = atoi( optarg );
         if ( max_iter < 0 )
           max_iter = -max_iter;
         break;
 
+      case 'd':
+#ifdef FTBENCH_COLD_CACHE
+        cold_cache = 1;
+#else
+        fprintf( stderr,
+                 "warning: dropping the page cache not available\n" );
+#endif
+        break;
+
+      case 'E':
+        target_ci = atof( optarg );
+        if ( target_ci < 0 )
+          target_ci = -target_ci;
+        break;
+
+      case 'e':
+        use_perf_events = 1;
+        break;
+
+      case 'F':
+        if ( !strcmp( optarg, "text" ) )
+          output_format = FORMAT_TEXT;
+        else if ( !strcmp( optarg, "json" ) )
+          output_format = FORMAT_JSON;
+        else if ( !strcmp( optarg, "csv" ) )
+          output_format = FORMAT_CSV;
+        else
+          usage();
+        break;
+
       case 'f':
         load_flags = strtol( optarg, NULL, 16 );
         break;
 
+      case 'G':
+#ifdef FTBENCH_THREADS
+        share_caches = 1;
+#else
+        fprintf( stderr,
+                 "warning: shared caches not available\n" );
+#endif
+        break;
+
       case 'H':
         engine = optarg;
 
@@ -1095,15 +10144,7 @@
         {
           if ( !strcmp( engine, ps_hinting_engine_names[j] ) )
           {
-            FT_Property_Set( lib,
-                             "cff",
-                             "hinting-engine", &j );
-            FT_Property_Set( lib,
-                             "type1",
-                             "hinting-engine", &j );
-            FT_Property_Set( lib,
-                             "t1cid",
-                             "hinting-engine", &j );
+            ps_hinting_engine = j;
             break;
           }
         }
@@ -1120,9 +10161,7 @@
         {
           if ( version == (int)tt_interpreter_versions[j] )
           {
-            FT_Property_Set( lib,
-                             "truetype",
-                             "interpreter-version", &version );
+            tt_interpreter_version = version;
             break;
           }
         }
@@ -1138,12 +10177,46 @@
 
           if ( sscanf( optarg, "%u%*[,:-]%u", &fi, &li ) == 2 )
           {
-            first_index = fi;
-            last_index  = li;
+            range_first = fi;
+            range_last  = li;
           }
         }
         break;
 
+      case 'j':
+#ifdef FTBENCH_THREADS
+        num_threads = atoi( optarg );
+        if ( num_threads < 1 )
+          num_threads = 1;
+#else
+        fprintf( stderr,
+                 "warning: multi-threaded mode not available\n" );
+#endif
+        break;
+
+      case 'K':
+        for ( j = 0; clocks[j].name; j++ )
+          if ( !strcmp( optarg, clocks[j].name ) )
+            break;
+        if ( !clocks[j].name )
+          usage();
+
+        timer_clock = clocks[j].get;
+        clock_name  = clocks[j].name;
+        break;
+
+      case 'k':
+        num_repeats = atoi( optarg );
+        if ( num_repeats < 1 || num_repeats > MAX_REPEATS )
+          usage();
+        break;
+
+      case 'L':
+        max_repeat_time = atof( optarg );
+        if ( max_repeat_time < 0 )
+          max_repeat_time = -max_repeat_time;
+        break;
+
       case 'l':
         {
           int  filter = atoi( optarg );
@@ -1156,7 +10229,8 @@
           case FT_LCD_FILTER_LIGHT:
           case FT_LCD_FILTER_LEGACY1:
           case FT_LCD_FILTER_LEGACY:
-            FT_Library_SetLcdFilter( lib, (FT_LcdFilter)filter );
+            lcd_filter     = (FT_LcdFilter)filter;
+            lcd_filter_set = 1;
           }
         }
         break;
@@ -1171,8 +10245,70 @@
         }
         break;
 
+      case 'M':
+        num_sweep_sizes = parse_list( optarg, values, MAX_LIST_VALUES );
+        if ( num_sweep_sizes < 0 )
+          usage();
+        for ( j = 0; j < num_sweep_sizes; j++ )
+          sweep_sizes[j] = (unsigned long)values[j];
+        break;
+
+      case 'O':
+        use_streams = 1;
+        break;
+
+      case 'o':
+        io_trace_file = optarg;
+        use_streams   = 1;
+        break;
+
+      case 'P':
+        {
+          char*  mode = optarg;
+
+
+          preload = 0;
+          while ( *mode )
+          {
+            size_t  len = strcspn( mode, "," );
+
+
+            if ( !strncmp( mode, "read", len ) && len == 4 )
+              preload |= PRELOAD_READ;
+            else if ( !strncmp( mode, "mmap", len ) && len == 4 )
+              preload |= PRELOAD_MMAP;
+            else if ( !strncmp( mode, "populate", len ) && len == 8 )
+              preload |= PRELOAD_MMAP | PRELOAD_POPULATE;
+            else if ( !strncmp( mode, "huge", len ) && len == 4 )
+              preload |= PRELOAD_MMAP | PRELOAD_HUGE;
+            else
+              usage();
+
+            mode += len;
+            if ( *mode )
+              mode++;
+          }
+        }
+        break;
+
       case 'p':
-        preload = 1;
+        preload = PRELOAD_READ;
+        break;
+
+      case 'Q':
+        soak_time = parse_duration( optarg );
+        if ( soak_time <= 0 )
+          usage();
+        break;
+
+      case 'q':
+        soak_interval = parse_duration( optarg );
+        if ( soak_interval <= 0 )
+          usage();
+        break;
+
+      case 'R':
+        compare_baseline_file = optarg;
         break;
 
       case 'r':
@@ -1187,6 +10323,19 @@
         }
         break;
 
+      case 'S':
+        num_sdf_spreads = parse_list( optarg, values, MAX_LIST_VALUES );
+        if ( num_sdf_spreads < 1 )
+          usage();
+        for ( j = 0; j < num_sdf_spreads; j++ )
+        {
+          /* the range supported by the SDF renderers */
+          sdf_spreads[j] = (int)values[j];
+          if ( sdf_spreads[j] < 2 || sdf_spreads[j] > 32 )
+            usage();
+        }
+        break;
+
       case 's':
         {
           int  sz = atoi( optarg );
@@ -1194,18 +10343,32 @@
 
           /* value 0 is special */
           if ( sz < 0 )
-            size = 1;
+            face_size = 1;
           else
-            size = (unsigned int)sz;
+            face_size = (unsigned int)sz;
         }
         break;
 
+      case 'T':
+        regression_threshold = atof( optarg );
+        if ( regression_threshold < 0 )
+          regression_threshold = -regression_threshold;
+        break;
+
       case 't':
         max_time = atof( optarg );
         if ( max_time < 0 )
           max_time = -max_time;
         break;
 
+      case 'u':
+        text_file = optarg;
+        break;
+
+      case 'V':
+        var_file = optarg;
+        break;
+
       case 'v':
         {
           FT_Int  major, minor, patch;
@@ -1221,6 +10384,61 @@
         }
         /* break; */
 
+      case 'W':
+        warmup_iter = atoi( optarg );
+        if ( warmup_iter < 0 )
+          warmup_iter = 0;
+        break;
+
+      case 'w':
+#ifdef FTBENCH_THREADS
+        num_workers = atoi( optarg );
+        if ( num_workers < 1 )
+          num_workers = 1;
+#else
+        fprintf( stderr,
+                 "warning: worker threads not available\n" );
+#endif
+        break;
+
+      case 'X':
+        matrix_dims = optarg;
+        if ( !*matrix_dims                                           ||
+             strspn( matrix_dims, "ihtal" ) != strlen( matrix_dims ) )
+          usage();
+        break;
+
+      case 'y':
+        {
+          char*  comma = strchr( optarg, ',' );
+
+
+          if ( !comma || comma == optarg || !comma[1] )
+            usage();
+
+          *comma    = '\0';
+          ab_libs[0] = optarg;
+          ab_libs[1] = comma + 1;
+        }
+#ifndef FTBENCH_AB
+        fprintf( stderr,
+                 "warning: A/B mode not available\n" );
+        ab_libs[0] = NULL;
+#endif
+        break;
+
+      case 'Z':
+        num_ppem_sizes = parse_list( optarg, ppem_sizes, MAX_LIST_VALUES );
+        if ( num_ppem_sizes < 1 )
+          usage();
+        break;
+
+      case 'z':
+        num_sdf_sizes = parse_list( optarg, sdf_sizes, MAX_LIST_VALUES );
+        if ( num_sdf_sizes < 1 )
+          usage();
+        break;
+
       default:
         usage();
         break;
@@ -1230,252 +10448,359 @@
     argc -= optind;
     argv += optind;
 
-    if ( argc != 1 )
+    if ( preload & PRELOAD_MMAP )
+    {
+#ifdef FTBENCH_MMAP
+      /* reading and mapping are exclusive */
+      preload &= ~PRELOAD_READ;
+      snprintf( preload_mode, sizeof ( preload_mode ), "mmap%s%s",
+                preload & PRELOAD_POPULATE ? ",populate" : "",
+                preload & PRELOAD_HUGE ? ",huge" : "" );
+#else
+      fprintf( stderr,
+               "warning: memory-mapped preloading not available\n" );
+      preload = PRELOAD_READ;
+#endif
+    }
+    if ( preload == PRELOAD_READ )
+      strcpy( preload_mode, "read" );
+
+    if ( argc < 1 )
       usage();
 
-    filename = *argv;
+    filename       = *argv;
+    requested_size = face_size;
 
-    if ( get_face( &face ) )
-      goto Exit;
+    if ( compare_baseline_file                              &&
+         baseline_load( &reference, compare_baseline_file ) )
+      return 1;
 
-    if ( first_index >= (unsigned int)face->num_glyphs )
-      first_index = (unsigned int)face->num_glyphs - 1;
-    if ( last_index  >= (unsigned int)face->num_glyphs )
-      last_index  = (unsigned int)face->num_glyphs - 1;
-    incr_index  = last_index > first_index ? 1 : -1;
+    if ( text_file && get_text( &text ) )
+      return 1;
 
-    if ( size )
+    if ( use_perf_events && !perf_open( &main_perf ) )
     {
-      if ( FT_IS_SCALABLE( face ) )
-      {
-        if ( FT_Set_Pixel_Sizes( face, size, size ) )
-        {
-          fprintf( stderr, "failed to set pixel size to %u\n", size );
+      fprintf( stderr,
+               "warning: hardware performance counters not available\n" );
+      use_perf_events = 0;
+    }
 
-          return 1;
-        }
-      }
-      else
+    {
+      FT_Int  major, minor, patch;
+
+
+      FT_Library_Version( lib, &major, &minor, &patch );
+      snprintf( info.version, sizeof ( info.version ),
+                "%d.%d.%d", major, minor, patch );
+    }
+    info.engine      = engine;
+    info.interpreter = version;
+    info.max_iter    = max_iter;
+    info.max_time    = max_time;
+
+    /* soak mode and the size sweep report the bytes allocated by FreeType */
+    if ( ( soak_time > 0 || num_ppem_sizes )      &&
+         argc == 1 && !is_directory( filename )   )
+      count_allocs = 1;
+
+    /* the library used so far to collect the available properties */
+    /* doesn't count its allocations                               */
+    if ( count_allocs )
+    {
+      FT_Done_FreeType( lib );
+      if ( new_library( &lib ) )
       {
-        size = (unsigned int)face->available_sizes[0].size >> 6;
-        fprintf( stderr,
-                 "using size of first bitmap strike (%upx)\n", size );
-        FT_Select_Size( face, 0 );
+        fprintf( stderr, "could not initialize font library\n" );
+
+        return 1;
       }
     }
 
-    FTC_Manager_New( lib,
-                     0,
-                     0,
-                     max_bytes,
-                     face_requester,
-                     face,
-                     &cache_man );
-
-    font_type.face_id = (FTC_FaceID)1;
-    font_type.width   = size;
-    font_type.height  = size;
-    font_type.flags   = load_flags;
-
-    printf( "\n"
-            "ftbench results for font `%s'\n"
-            "---------------------------",
-            filename );
-    for ( i = 0; i < strlen( filename ); i++ )
-      putchar( '-' );
-    putchar( '\n' );
-
-    printf( "\n"
-            "family: %s\n"
-            " style: %s\n"
-            "\n",
-            face->family_name,
-            face->style_name );
-
-    if ( max_iter )
-      printf( "number of iterations for each test: at most %d\n",
-              max_iter );
-    printf( "number of seconds for each test: %s%f\n",
-             max_iter ? "at most " : "",
-             max_time );
-
-    printf( "\n"
-            "glyph indices: from %u to %u\n"
-            "face size: %uppem\n"
-            "font preloading into memory: %s\n",
-            first_index,
-            last_index,
-            size,
-            preload ? "yes" : "no" );
-
-    printf( "\n"
-            "load flags: 0x%X\n"
-            "render mode: %u\n",
-            load_flags,
-            render_mode );
-    printf( "\n"
-            "CFF hinting engine set to `%s'\n"
-            "TrueType interpreter set to version %d\n"
-            "maximum cache size: %luKiByte\n",
-            engine,
-            version,
-            max_bytes / 1024 );
+    set_library_properties( lib );
 
-    printf( "\n"
-            "executing tests:\n" );
+    /* worker threads get pinned to the following CPUs */
+    pin_thread( 0 );
 
-    for ( j = 0; j < N_FT_BENCH; j++ )
+#if defined FTBENCH_COLD_CACHE || defined FTBENCH_IO_LATENCY
+    /* CPU time doesn't include waiting for I/O */
+    if ( ( cold_cache || io_latency > 0 )   &&
+         ( !strcmp( clock_name, "cpu" )     ||
+           !strcmp( clock_name, "process" ) ) )
     {
-      btest_t   test;
-      FT_ULong  flags;
+      timer_clock = bench_wall_time;
+      clock_name  = "wall";
+    }
+#endif
+#ifdef FTBENCH_TSC
+    if ( timer_clock == get_tsc_time )
+      calibrate_tsc();
+#endif
+    /* the median duration of an empty timed section with the */
+    /* selected clock, to be subtracted from all timed sections */
+    timer_overhead = bench_calibrate( timer_clock );
 
+    /* several fonts or a directory: corpus mode */
+    if ( argc > 1 || is_directory( filename ) )
+    {
+      for ( j = 0; j < argc; j++ )
+        add_fonts( argv[j] );
 
-      if ( !TEST( 'a' + j ) )
-        continue;
+      if ( !corpus.num_fonts )
+      {
+        fprintf( stderr, "no fonts found\n" );
+        free_corpus();
 
-      test.title       = NULL;
-      test.bench       = NULL;
-      test.cache_first = 0;
-      test.user_data   = NULL;
+        return 1;
+      }
 
-      switch ( j )
+      if ( num_threads > 1 )
       {
-      case FT_BENCH_LOAD_GLYPH:
-        test.title = "Load";
-        test.bench = test_load;
-        benchmark( face, &test, max_iter, max_time );
-
-        if ( compare_cached )
-        {
-          test.cache_first = 1;
+        fprintf( stderr,
+                 "warning: option `-j' is ignored in corpus mode\n" );
+        num_threads = 1;
+      }
+      if ( num_sweep_sizes )
+      {
+        fprintf( stderr,
+                 "warning: option `-M' is ignored in corpus mode\n" );
+        num_sweep_sizes = 0;
+      }
+      if ( matrix_dims )
+      {
+        fprintf( stderr,
+                 "warning: option `-X' is ignored in corpus mode\n" );
+        matrix_dims = NULL;
+      }
+      if ( use_streams )
+      {
+        fprintf( stderr,
+                 "warning: options `-D', `-O', and `-o' are ignored"
+                 " in corpus mode\n" );
+        use_streams   = 0;
+        io_latency    = 0;
+        io_trace_file = NULL;
+      }
+      if ( num_repeats > 1 || target_ci > 0 )
+      {
+        fprintf( stderr,
+                 "warning: options `-k' and `-E' are ignored"
+                 " in corpus mode\n" );
+        num_repeats = 1;
+        target_ci   = 0;
+      }
+      if ( soak_time > 0 )
+      {
+        fprintf( stderr,
+                 "warning: option `-Q' is ignored in corpus mode\n" );
+        soak_time = 0;
+      }
+      if ( num_ppem_sizes )
+      {
+        fprintf( stderr,
+                 "warning: option `-Z' is ignored in corpus mode\n" );
+        num_ppem_sizes = 0;
+      }
+      if ( ab_libs[0] )
+      {
+        fprintf( stderr,
+                 "warning: option `-y' is ignored in corpus mode\n" );
+        ab_libs[0] = NULL;
+      }
 
-          test.title = "Load (image cached)";
-          test.bench = test_image_cache;
-          benchmark( face, &test, max_iter, max_time );
+      info.num_fonts   = corpus.num_fonts;
+      info.num_files   = corpus.num_files;
+      info.num_workers = num_workers;
 
-          test.title = "Load (sbit cached)";
-          test.bench = test_sbit_cache;
-          if ( size )
-            benchmark( face, &test, max_iter, max_time );
-          else
-            printf( "  %-25s disabled (size = 0)\n", test.title );
-        }
-        break;
+      report_begin( NULL );
+      run_corpus( max_iter, max_time );
 
-      case FT_BENCH_LOAD_ADVANCES:
-        test.user_data = &flags;
+      free_corpus();
+      goto Exit;
+    }
 
-        test.title = "Load_Advances (Normal)";
-        test.bench = test_load_advances;
-        flags      = FT_LOAD_DEFAULT;
-        benchmark( face, &test, max_iter, max_time );
+    if ( soak_time > 0 )
+    {
+      if ( num_threads > 1 || num_sweep_sizes || matrix_dims ||
+           num_repeats > 1 || target_ci > 0 || num_ppem_sizes ||
+           save_baseline_file || compare_baseline_file       ||
+           ab_libs[0]                                        )
+        fprintf( stderr,
+                 "warning: options `-B', `-E', `-j', `-k', `-M', `-R',"
+                 " `-X', `-y', and `-Z' are ignored in soak mode\n" );
+
+      num_threads           = 1;
+      num_sweep_sizes       = 0;
+      num_ppem_sizes        = 0;
+      matrix_dims           = NULL;
+      save_baseline_file    = NULL;
+      compare_baseline_file = NULL;
+      ab_libs[0]            = NULL;
+    }
 
-        test.title  = "Load_Advances (Fast)";
-        test.bench  = test_load_advances;
-        flags       = FT_LOAD_TARGET_LIGHT;
-        benchmark( face, &test, max_iter, max_time );
+    if ( ab_libs[0] && ( matrix_dims || num_ppem_sizes ) )
+    {
+      fprintf( stderr,
+               "warning: option `-y' is ignored"
+               " with options `-X' and `-Z'\n" );
+      ab_libs[0] = NULL;
+    }
 
-        test.title  = "Load_Advances (Unscaled)";
-        test.bench  = test_load_advances;
-        flags       = FT_LOAD_NO_SCALE;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+    if ( ab_libs[0] )
+    {
+      if ( num_threads > 1 || num_sweep_sizes || num_repeats > 1 ||
+           use_streams || compare_cached                         ||
+           save_baseline_file || compare_baseline_file           )
+        fprintf( stderr,
+                 "warning: options `-B', `-C', `-D', `-j', `-k', `-M',"
+                 " `-O', `-o', and `-R' are ignored in A/B mode\n" );
+
+      num_threads           = 1;
+      num_sweep_sizes       = 0;
+      num_repeats           = 1;
+      use_streams           = 0;
+      io_latency            = 0;
+      io_trace_file         = NULL;
+      compare_cached        = 0;
+      save_baseline_file    = NULL;
+      compare_baseline_file = NULL;
+    }
 
-      case FT_BENCH_RENDER:
-        test.title = "Render";
-        test.bench = test_render;
-        if ( size )
-          benchmark( face, &test, max_iter, max_time );
-        else
-          printf( "  %-25s disabled (size = 0)\n", test.title );
-        break;
+    if ( use_streams && ( num_threads > 1 || matrix_dims ) )
+    {
+      fprintf( stderr,
+               "warning: options `-D', `-O', and `-o' are ignored"
+               " with options `-j' and `-X'\n" );
+      use_streams   = 0;
+      io_latency    = 0;
+      io_trace_file = NULL;
+    }
 
-      case FT_BENCH_GET_GLYPH:
-        test.title = "Get_Glyph";
-        test.bench = test_get_glyph;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+    if ( io_trace_file )
+    {
+      io_trace = fopen( io_trace_file, "w" );
+      if ( !io_trace )
+      {
+        fprintf( stderr, "couldn't open trace file `%s'\n",
+                 io_trace_file );
 
-      case FT_BENCH_GET_CBOX:
-        test.title = "Get_CBox";
-        test.bench = test_get_cbox;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+        return 1;
+      }
+    }
 
-      case FT_BENCH_GET_BBOX:
-        test.title = "Get_BBox";
-        test.bench = test_get_bbox;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+    if ( matrix_dims )
+    {
+      if ( num_threads > 1 || num_sweep_sizes    ||
+           num_repeats > 1 || target_ci > 0     ||
+           num_ppem_sizes                       ||
+           save_baseline_file || compare_baseline_file )
+        fprintf( stderr,
+                 "warning: options `-B', `-E', `-j', `-k', `-M', `-R',"
+                 " and `-Z' are ignored in matrix mode\n" );
 
-      case FT_BENCH_CMAP:
-        {
-          bcharset_t  charset;
+      run_matrix( max_iter, max_time );
+      goto Exit;
+    }
 
+    if ( num_ppem_sizes )
+    {
+      if ( num_threads > 1 || num_sweep_sizes               ||
+           num_repeats > 1 || target_ci > 0                ||
+           save_baseline_file || compare_baseline_file      )
+        fprintf( stderr,
+                 "warning: options `-B', `-E', `-j', `-k', `-M', and `-R'"
+                 " are ignored in size sweep mode\n" );
 
-          get_charset( face, &charset );
-          if ( charset.code )
-          {
-            test.user_data = (void*)&charset;
+      num_threads           = 1;
+      num_sweep_sizes       = 0;
+      save_baseline_file    = NULL;
+      compare_baseline_file = NULL;
+    }
 
+    if ( num_threads > 1 && ( num_repeats > 1 || target_ci > 0 ) )
+      fprintf( stderr,
+               "warning: options `-k' and `-E' are ignored"
+               " with option `-j'\n" );
 
-            test.title = "Get_Char_Index";
-            test.bench = test_get_char_index;
+    if ( share_caches && num_threads < 2 )
+    {
+      fprintf( stderr, "warning: option `-G' needs option `-j'\n" );
+      share_caches = 0;
+    }
 
-            benchmark( face, &test, max_iter, max_time );
+    if ( get_face( &face ) )
+      goto Exit;
 
-            if ( compare_cached )
-            {
-              test.cache_first = 1;
+    set_index_range( face );
 
-              test.title = "Get_Char_Index (cached)";
-              test.bench = test_cmap_cache;
-              benchmark( face, &test, max_iter, max_time );
-            }
+    if ( face_size )
+    {
+      if ( FT_IS_SCALABLE( face ) )
+      {
+        if ( set_face_size( face ) )
+        {
+          fprintf( stderr, "failed to set pixel size to %u\n",
+                   face_size );
 
-            free( charset.code );
-          }
+          return 1;
         }
-        break;
+      }
+      else
+      {
+        face_size = (unsigned int)face->available_sizes[0].size >> 6;
+        fprintf( stderr,
+                 "using size of first bitmap strike (%upx)\n",
+                 face_size );
+        set_face_size( face );
+      }
+    }
 
-      case FT_BENCH_CMAP_ITER:
-        test.title = "Iterate CMap";
-        test.bench = test_cmap_iter;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+    FTC_Manager_New( lib,
+                     0,
+                     max_sizes,
+                     max_bytes,
+                     face_requester,
+                     face,
+                     &cache_man );
 
-      case FT_BENCH_NEW_FACE:
-        test.title = "New_Face";
-        test.bench = test_new_face;
-        benchmark( face, &test, max_iter, max_time );
-        break;
+    font_type.face_id = (FTC_FaceID)1;
+    font_type.width   = face_size;
+    font_type.height  = face_size;
+    font_type.flags   = load_flags;
 
-      case FT_BENCH_EMBOLDEN:
-        test.title = "Embolden";
-        test.bench = test_embolden;
-        if ( size )
-          benchmark( face, &test, max_iter, max_time );
-        else
-          printf( "  %-25s disabled (size = 0)\n", test.title );
-        break;
+#ifdef FTBENCH_AB
+    if ( ab_libs[0] && ( ab_open( 0 ) || ab_open( 1 ) ) )
+    {
+      ab_close( &ab_apis[0] );
 
-      case FT_BENCH_STROKE:
-        test.title = "Stroke";
-        test.bench = test_stroke;
-        if ( size )
-          benchmark( face, &test, max_iter, max_time );
-        else
-          printf( "  %-25s disabled (size = 0)\n", test.title );
-        break;
+      return 1;
+    }
+#endif
 
-      case FT_BENCH_NEW_FACE_AND_LOAD_GLYPH:
-        test.title = "New_Face & load glyph(s)";
-        test.bench = test_new_face_and_load_glyph;
-        benchmark( face, &test, max_iter, max_time );
-        break;
-      }
+    report_begin( face );
+
+    if ( soak_time > 0 )
+    {
+      run_soak( face );
+      goto Exit;
     }
 
+#ifdef FTBENCH_AB
+    if ( ab_libs[0] )
+      run_ab( face, max_iter, max_time );
+    else
+#endif
+    if ( num_sweep_sizes )
+      run_sweep( face, max_iter, max_time );
+    else if ( num_ppem_sizes )
+      run_ppem_sweep( face, max_iter, max_time );
+    else
+      run_tests( face, max_iter, max_time );
+
+    report_end();
+
+    if ( save_baseline_file )
+      baseline_save( &recorded, save_baseline_file );
+
   Exit:
     /* The following is a bit subtle: When we call FTC_Manager_Done, this
      * normally destroys all FT_Face objects that the cache might have
@@ -1495,9 +10820,26 @@
     if ( cache_man )
       FTC_Manager_Done( cache_man );
 
-    FT_Done_FreeType( lib );
+    done_library( lib );
 
-    return 0;
+#ifdef FTBENCH_AB
+    ab_close( &ab_apis[0] );
+    ab_close( &ab_apis[1] );
+#endif
+
+    if ( use_perf_events )
+      perf_close( &main_perf );
+
+    baseline_free( &recorded );
+    baseline_free( &reference );
+
+    if ( io_trace )
+      fclose( io_trace );
+
+    free( text.code );
+
+    /* signal regressions to scripts */
+    return num_regressions ? 2 : 0;
   }
 
 
@@ -26,14 +26,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>    /* for clock() */
 
-  /* SunOS 4.1.* does not define CLOCKS_PER_SEC, so include <sys/param.h> */
-  /* to get the HZ macro which is the equivalent.                         */
-#if defined( __sun__ ) && !defined( SVR4 ) && !defined( __SVR4 )
-#include <sys/param.h>
-#define CLOCKS_PER_SEC HZ
-#endif
+#include "bench.h"
 
 #define CHARSIZE    400   /* character point size */
 #define MAX_GLYPHS  512   /* Maximum number of glyphs rendered at one time */
@@ -60,6 +54,8 @@
   short       antialias = 1; /* smooth fonts with gray levels  */
   short       force_low;
 
+  bsuite_t    suite;
+
 
   static void
   Panic( const char*  message )
@@ -69,21 +65,6 @@
   }
 
 
-  /*******************************************************************/
-  /*                                                                 */
-  /*  Get_Time:                                                      */
-  /*                                                                 */
-  /*    Returns the current time in milliseconds.                    */
-  /*                                                                 */
-  /*******************************************************************/
-
-  static long
-  Get_Time( void )
-  {
-    return clock() * 10000 / CLOCKS_PER_SEC;
-  }
-
-
   /*******************************************************************/
   /*                                                                 */
   /*  LoadChar:                                                      */
@@ -152,6 +133,8 @@
     fprintf( stderr, "   -m : render monochrome glyphs (default is anti-aliased)\n" );
     fprintf( stderr, "   -a : use smooth anti-aliaser\n" );
     fprintf( stderr, "   -l : force low quality even at small sizes\n" );
+    fprintf( stderr, "   -F : output format, `text' (default) or `json'\n" );
+    fprintf( stderr, "\nTimes are CPU times of the calling thread, as with ftbench.\n" );
 
     exit( 1 );
   }
@@ -161,15 +144,19 @@
   main( int     argc,
         char**  argv )
   {
-    int    i, total, base, rendered_glyphs;
-    char   filename[1024 + 4];
+    int       i, total, base, rendered_glyphs;
+    char      filename[1024 + 4];
 
-    long   t, t0, tz0;
+    double    t, t0, tz0;
+    bstats_t  stats;
 
 
     antialias = 1;
     force_low = 0;
 
+    bench_init();
+    bench_suite_init( &suite, "fttimer", 0 );
+
     while ( argc > 1 && argv[1][0] == '-' )
     {
       switch ( argv[1][1] )
@@ -200,6 +187,19 @@
           repeat_count = 1;
         break;
 
+      case 'F':
+        argc--;
+        argv++;
+        if ( argc < 2 )
+          Usage();
+        if ( !strcmp( argv[1], "text" ) )
+          suite.format = BENCH_FORMAT_TEXT;
+        else if ( !strcmp( argv[1], "json" ) )
+          suite.format = BENCH_FORMAT_JSON;
+        else
+          Usage();
+        break;
+
       default:
         fprintf( stderr, "Unknown argument `%s'\n", argv[1] );
         Usage();
@@ -259,19 +259,23 @@
 
     rendered_glyphs = 0;
 
+    suite.overhead = bench_calibrate( suite.clock );
+    bench_samples_reset( &suite.samples );
+
     t0 = 0;  /* Initial time */
 
-    tz0 = Get_Time();
+    tz0 = suite.clock();
 
     while ( total > 0 )
     {
-      int  repeat;
+      int  repeat, rendered = 0;
 
 
       /* First, preload 'tab_glyphs' in memory */
       cur_glyph = 0;
 
-      printf( "loading %d glyphs", tab_glyphs );
+      if ( suite.format == BENCH_FORMAT_TEXT )
+        printf( "loading %d glyphs", tab_glyphs );
 
       for ( Num = 0; Num < tab_glyphs; Num++ )
       {
@@ -287,11 +291,12 @@
       if ( tab_glyphs > total )
         tab_glyphs = total;
 
-      printf( ", rendering... " );
+      if ( suite.format == BENCH_FORMAT_TEXT )
+        printf( ", rendering... " );
 
       /* Now, render the loaded glyphs */
 
-      t = Get_Time();
+      t = suite.clock();
 
       for ( repeat = 0; repeat < repeat_count; repeat++ )
       {
@@ -300,35 +305,59 @@
           if ( ( error = ConvertRaster( Num ) ) != 0 )
             Fail++;
           else
-            rendered_glyphs++;
+            rendered++;
         }
       }
 
-      t = Get_Time() - t;
-      if ( t < 0 )
-        t += 1000 * 60 * 60;
+      t = suite.clock() - t - suite.overhead;
 
-      printf( " = %f s\n", (double)t / 10000 );
+      if ( suite.format == BENCH_FORMAT_TEXT )
+        printf( " = %f s\n", t / 1E6 );
       t0 += t;
 
+      rendered_glyphs += rendered;
+      bench_samples_add( &suite.samples, t, rendered );
+
       /* Now free all loaded outlines */
       for ( Num = 0; Num < cur_glyph; Num++ )
         FT_Done_Glyph( glyphs[Num] );
     }
 
-    tz0 = Get_Time() - tz0;
+    tz0 = suite.clock() - tz0;
 
     FT_Done_Face( face );
 
-    printf( "\n" );
-    printf( "rendered glyphs  = %d\n", rendered_glyphs );
-    printf( "render time      = %f s\n", (double)t0 / 10000 );
-    printf( "fails            = %d\n", Fail );
-    printf( "average glyphs/s = %f\n",
-            (double)rendered_glyphs / t0 * 10000 );
+    if ( suite.format == BENCH_FORMAT_TEXT )
+    {
+      printf( "\n" );
+      printf( "rendered glyphs  = %d\n", rendered_glyphs );
+      printf( "render time      = %f s\n", t0 / 1E6 );
+      printf( "fails            = %d\n", Fail );
+      printf( "average glyphs/s = %f\n",
+              (double)rendered_glyphs / t0 * 1E6 );
+
+      printf( "total timing     = %f s\n", tz0 / 1E6 );
+      printf( "Fails = %d\n", Fail );
+      printf( "\n" );
+    }
+
+    /* the same summary as the other benchmark tools; fttimer has no */
+    /* time limit, so report the duration of the whole run          */
+    suite.max_time = tz0 / 1E6;
+
+    bench_report_begin( &suite );
+    if ( rendered_glyphs )
+    {
+      stats.done      = rendered_glyphs;
+      stats.time      = t0;
+      stats.us_per_op = t0 / rendered_glyphs;
+      bench_stats( &suite.samples, &stats );
 
-    printf( "total timing     = %f s\n", (double)tz0 / 10000 );
-    printf( "Fails = %d\n", Fail );
+      bench_report( &suite, "Render", NULL, &stats );
+    }
+    else
+      bench_report( &suite, "Render", "no error-free calls", NULL );
+    bench_report_end( &suite );
 
     FT_Done_FreeType( library );
 
@@ -32,10 +32,8 @@
   *
   */
 
-#ifdef UNIX
-#include <sys/time.h>
-#endif
 #include "gbench.h"
+#include "bench.h"
 
 #define  xxCACHE
 
@@ -459,63 +457,13 @@
 
 
 
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <time.h>
-
-#ifdef UNIX
-#include <sys/time.h>
-#endif
-
-typedef int  (*bench_t)( int  arg );
-
-#define BENCH_TIME 3.0f
-
-double
-get_time(void)
-{
-#ifdef UNIX
-  struct timeval tv;
-
-  gettimeofday(&tv, NULL);
-  return (double)tv.tv_sec + (double)tv.tv_usec / 1E6;
-#else
-  /* clock() has an awful precision (~10ms) under Linux 2.4 + glibc 2.2 */
-  return (double)clock() / (double)CLOCKS_PER_SEC;
-#endif
-}
-
-
-double  bench_time = BENCH_TIME;
-
-static void
-bench( bench_t      bench_func,
-       int          bench_arg,
-       const char*  title,
-       int          max)
-{
-  int      i, n, done;
-  double   t0, delta;
-
-  printf("%-30s : ", title);
-  fflush(stdout);
-
-  n = 0;
-  done = 0;
-  t0 = get_time();
-  do
-  {
-    if (!(*bench_func)( bench_arg ) )
-      done++;
-    n++;
-    delta = get_time() - t0;
-  }
-  while ((!max || n < max) && delta < bench_time);
+#define BENCH_TIME 3.0
 
-  printf("%5.3f us/op\n", delta * 1E6 / (double)done);
-}
+static bsuite_t  suite;
 
+/* the arguments of the test functions */
+static int  direct = 0;
+static int  cached = 1;
 
 
 /* this is un-hinted "W" in Times New Roman
@@ -580,8 +528,9 @@ unsigned long  my_rand( void )
 #define  RAND(n)  ((unsigned int)my_rand() % (n))
 
 static int
-do_glyph( int  arg )
+do_glyph( void*  user_data )
 {
+  int          arg   = *(int*)user_data;
   GBlitterRec  blit;
   int          dst_x = RAND(SIZE_X);
   int          dst_y = RAND(SIZE_Y);
@@ -595,7 +544,7 @@ do_glyph( int  arg )
                              SIZE_Y,
                              buffer,
                              SIZE_X*3 ) )
-    return 1;
+    return 0;
 
   if ( arg )
     gblitter_blitrgb24_gray_cache( &blit, color );
@@ -603,14 +552,15 @@ do_glyph( int  arg )
     gblitter_blitrgb24_gray_direct( &blit, color );
 
 
-  return 0;
+  return 1;
 }
 
 
 
 static int
-do_glyph_color( int  arg )
+do_glyph_color( void*  user_data )
 {
+  int          arg   = *(int*)user_data;
   GBlitterRec  blit;
   int          dst_x = RAND(SIZE_X);
   int          dst_y = RAND(SIZE_Y);
@@ -627,20 +577,35 @@ do_glyph_color( int  arg )
                              SIZE_Y,
                              buffer,
                              SIZE_X*3 ) )
-    return 1;
+    return 0;
 
   if ( arg )
     gblitter_blitrgb24_gray_cache( &blit, color );
   else
     gblitter_blitrgb24_gray_direct( &blit, color );
 
-  return 0;
+  return 1;
 }
 
 
 static void
-dump_cache_stats( void )
+reset_buffer( void*  user_data )
 {
+  (void)user_data;
+
+  chits = cmiss1 = cmiss2 = 0;
+  memset( buffer, 0, sizeof(buffer) );
+}
+
+
+static void
+dump_cache_stats( void*  user_data )
+{
+  (void)user_data;
+
+  if ( suite.format != BENCH_FORMAT_TEXT )
+    return;
+
   printf( "hits = %ld, miss1 = %ld, miss2 = %ld, hitrate=%.2f%%, miss2rate=%.2f%%\n",
           chits, cmiss1, cmiss2, (double)chits*100.0 / (chits+cmiss1), (double)cmiss2*100.0 / (double)cmiss1 );
 }
@@ -659,19 +624,23 @@ void usage(void)
   "   -s seed  : specify random seed\n" );
   fprintf( stderr,
   "   -g gamma : specify gamma\n" );
+  fprintf( stderr,
+  "   -F fmt   : output format, `text' (default) or `json'\n" );
+  fprintf( stderr,
+  "\nTimes are CPU times of the calling thread, as with ftbench.\n" );
   exit( 1 );
 }
 
-#define TEST(x) (!tests || strchr(tests, x))
-
 int
 main(int argc,
      char** argv)
 {
   char* tests = NULL;
-  int size;
   double gamma = 1.0;
 
+  bench_init();
+  bench_suite_init( &suite, "gbench", BENCH_TIME );
+
   while (argc > 1 && argv[1][0] == '-')
   {
     switch (argv[1][1])
@@ -680,7 +649,20 @@ main(int argc,
       argc--;
       argv++;
       if (argc < 1 ||
-          sscanf(argv[1], "%lf", &bench_time) != 1)
+          sscanf(argv[1], "%lf", &suite.max_time) != 1)
+        usage();
+      break;
+
+    case 'F':
+      argc--;
+      argv++;
+      if (argc < 1)
+        usage();
+      if (!strcmp(argv[1], "text"))
+        suite.format = BENCH_FORMAT_TEXT;
+      else if (!strcmp(argv[1], "json"))
+        suite.format = BENCH_FORMAT_JSON;
+      else
         usage();
       break;
 
@@ -727,21 +709,16 @@ main(int argc,
 
   ggamma_set( gamma );
 
-  memset( buffer, 0, sizeof(buffer) );
-  if (TEST('a')) bench( do_glyph, 0, "direct white glyph", 0 );
+  bench_add( &suite, "direct white glyph", do_glyph,
+             reset_buffer, NULL, &direct );
+  bench_add( &suite, "cache white glyph", do_glyph,
+             reset_buffer, dump_cache_stats, &cached );
+  bench_add( &suite, "direct color glyph", do_glyph_color,
+             reset_buffer, NULL, &direct );
+  bench_add( &suite, "cache color glyph", do_glyph_color,
+             reset_buffer, dump_cache_stats, &cached );
 
-  chits = cmiss1 = cmiss2 = 0;
-  memset( buffer, 0, sizeof(buffer) );
-  if (TEST('b')) bench( do_glyph, 1, "cache white glyph", 0 );
-  dump_cache_stats();
-
-  memset( buffer, 0, sizeof(buffer) );
-  if (TEST('c')) bench( do_glyph_color, 0, "direct color glyph", 0 );
-
-  chits = cmiss1 = cmiss2 = 0;
-  memset( buffer, 0, sizeof(buffer) );
-  if (TEST('d')) bench( do_glyph_color, 1, "cache color glyph", 0 );
-  dump_cache_stats();
+  bench_run( &suite, tests );
 
   return 0;
 }